@@ -31,6 +31,27 @@ uint16_t nextIdenticalHammingWeight(uint16_t weight);
 //   quotient * divisor = dividend (modulo 2^32)
 uint32_t divide(uint32_t dividend, uint32_t divisor);
 
+// number of set bits
+inline unsigned popcount(uint64_t n) {
+#if defined(__GNUC__) && defined(__POPCNT__)
+  return static_cast<unsigned>(__builtin_popcountll(n));
+#else
+  n = n - ((n >> 1) & 0x5555555555555555ULL);
+  n = (n & 0x3333333333333333ULL) + ((n >> 2) & 0x3333333333333333ULL);
+  n = (n + (n >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return static_cast<unsigned>((n * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// number of zeros below the lowest set bit (n must not be zero)
+inline unsigned countTrailingZeros(uint64_t n) {
+#if defined(__GNUC__)
+  return static_cast<unsigned>(__builtin_ctzll(n));
+#else
+  return popcount((n & (~n + 1)) - 1);
+#endif
+}
+
 // number of bits required to represent an (unsigned)
 // number.
 template <class T> T bit_width(T n) {
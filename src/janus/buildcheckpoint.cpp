@@ -0,0 +1,105 @@
+// Copyright (C) 2022 Greg Dionne
+// Distributed under MIT License
+#include "buildcheckpoint.hpp"
+#include "utils/stripedfile.hpp"
+
+#include <cstdio>
+#include <vector>
+
+#if !defined(_MSC_VER) && !defined(__MINGW32__) && !defined(__MINGW64__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Janus {
+
+static void ignoreProgress(std::size_t) {}
+
+// make sure the file reaches the disk before it is renamed into place
+static bool flushToDisk(const std::string &path) {
+#if !defined(_MSC_VER) && !defined(__MINGW32__) && !defined(__MINGW64__)
+  int fd = open(path.c_str(), O_WRONLY);
+  if (fd == -1) {
+    return false;
+  }
+  bool synced = fsync(fd) == 0;
+  return close(fd) == 0 && synced;
+#else
+  (void)path;
+  return true;
+#endif
+}
+
+BuildCheckpoint::BuildCheckpoint(const std::string &tableFilename)
+    : path(tableFilename + ".checkpoint"),
+      tempPath(tableFilename + ".checkpoint.tmp") {}
+
+bool BuildCheckpoint::save(const uint8_t *table, DepthTableHeader header,
+                           uint8_t pass) const {
+  const std::size_t nBytes = header.getNBytes();
+
+  // checkpoints are never compressed
+  header.setPass(pass);
+  header.setFormat(DepthTableHeader::Format::raw);
+  header.sign(table);
+  std::vector<uint8_t> page(DepthTableHeader::size);
+  header.write(page.data());
+
+  utils::StripedFile file({tempPath});
+  bool saved =
+      file.write(page.data(), page.size(), 0, ignoreProgress) ==
+          page.size() &&
+      file.write(table, nBytes, page.size(), ignoreProgress) == nBytes &&
+      flushToDisk(tempPath);
+
+#if defined(_MSC_VER) || defined(__MINGW32__) || defined(__MINGW64__)
+  // rename won't replace an existing file here
+  std::remove(path.c_str());
+#endif
+
+  if (!saved || std::rename(tempPath.c_str(), path.c_str()) != 0) {
+    std::remove(tempPath.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+uint8_t BuildCheckpoint::load(uint8_t *table,
+                              const DepthTableHeader &expected) const {
+  const std::size_t nBytes = expected.getNBytes();
+
+  utils::StripedFile file({path});
+  if (file.size() != DepthTableHeader::size + nBytes) {
+    return 0;
+  }
+
+  std::vector<uint8_t> page(DepthTableHeader::size);
+  DepthTableHeader found(expected);
+  if (file.read(page.data(), page.size(), 0, ignoreProgress) != page.size() ||
+      !found.read(page.data()) || found.getPass() == 0 ||
+      found.getFormat() != DepthTableHeader::Format::raw) {
+    return 0;
+  }
+
+  // any pass will do, provided the table is otherwise the same
+  DepthTableHeader compatible(expected);
+  compatible.setPass(found.getPass());
+  if (!found.mismatch(compatible).empty()) {
+    return 0;
+  }
+
+  if (file.read(table, nBytes, page.size(), ignoreProgress) != nBytes ||
+      found.verify(table) != found.getNBlocks()) {
+    return 0;
+  }
+
+  return found.getPass();
+}
+
+void BuildCheckpoint::remove() const {
+  std::remove(path.c_str());
+  std::remove(tempPath.c_str());
+}
+
+} // namespace Janus
@@ -0,0 +1,46 @@
+// Copyright (C) 2022 Greg Dionne
+// Distributed under MIT License
+#ifndef JANUS_BUILDCHECKPOINT_HPP
+#define JANUS_BUILDCHECKPOINT_HPP
+
+#include "depthtableheader.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace Janus {
+
+// A depth table saved part way through its build.
+//
+// The checkpoint is kept next to the saved table as
+// <filename>.checkpoint and holds a header page (marked with the last
+// pass built) followed by the table.  It is first written to
+// <filename>.checkpoint.tmp and only renamed into place once it is
+// complete, so an interrupted save never replaces a good checkpoint.
+// The block checksums in the header are verified before a checkpoint
+// is used.
+class BuildCheckpoint {
+public:
+  explicit BuildCheckpoint(const std::string &tableFilename);
+
+  // saves the table as built through the specified pass.
+  // returns false if it could not be saved.
+  bool save(const uint8_t *table, DepthTableHeader header,
+            uint8_t pass) const;
+
+  // loads an intact checkpoint compatible with the expected header.
+  // returns the last pass it holds, or zero if there is none.
+  uint8_t load(uint8_t *table, const DepthTableHeader &expected) const;
+
+  // removes the checkpoint (if any)
+  void remove() const;
+
+  const std::string &getPath() const { return path; }
+
+private:
+  const std::string path;
+  const std::string tempPath;
+};
+
+} // namespace Janus
+#endif
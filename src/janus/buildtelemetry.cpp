@@ -0,0 +1,87 @@
+// Copyright (C) 2022 Greg Dionne
+// Distributed under MIT License
+#include "buildtelemetry.hpp"
+#include "strutils.hpp"
+
+namespace Janus {
+
+BuildTelemetry::BuildTelemetry(const std::string &telemetryPath)
+    : path(telemetryPath) {
+  if (!path.empty()) {
+    file = std::fopen(path.c_str(), "a");
+  }
+}
+
+BuildTelemetry::~BuildTelemetry() {
+  if (file) {
+    std::fclose(file);
+  }
+}
+
+// hours, minutes and seconds
+static std::string to_hms(double seconds) {
+  auto s = static_cast<unsigned long>(seconds + 0.5);
+  char hms[32];
+  std::snprintf(hms, sizeof(hms), "%lu:%02lu:%02lu", s / 3600, s / 60 % 60,
+                s % 60);
+  return hms;
+}
+
+std::string BuildTelemetry::record(const Pass &pass) {
+  elapsed += pass.seconds;
+
+  double expandRate = pass.seconds > 0 ? pass.nExpanded / pass.seconds : 0;
+  double scanRate = pass.seconds > 0 ? pass.scanBytes / pass.seconds : 0;
+  double diskRate = pass.seconds > 0 ? pass.diskBytes / pass.seconds : 0;
+  double reachRate = pass.seconds > 0 ? pass.nReached / pass.seconds : 0;
+  bool estimated = pass.nUnreached == 0 || reachRate > 0;
+  double remaining = pass.nUnreached ? pass.nUnreached / reachRate : 0;
+
+  if (file) {
+    std::string threads;
+    char number[32];
+    for (auto seconds : pass.threadSeconds) {
+      std::snprintf(number, sizeof(number), "%.3f", seconds);
+      threads += (threads.empty() ? "" : ",") + std::string(number);
+    }
+
+    std::fprintf(file,
+                 "{\"pass\":%u,\"kind\":\"%s\",\"seconds\":%.3f,"
+                 "\"reached\":%zu,\"expanded\":%zu,\"expandRate\":%.1f,"
+                 "\"scanBytes\":%zu,\"scanRate\":%.1f,\"diskBytes\":%zu,"
+                 "\"threadSeconds\":[%s],\"unreached\":%zu,"
+                 "\"elapsed\":%.3f,\"remaining\":",
+                 static_cast<unsigned>(pass.pass), pass.kind, pass.seconds,
+                 pass.nReached, pass.nExpanded, expandRate, pass.scanBytes,
+                 scanRate, pass.diskBytes, threads.c_str(), pass.nUnreached,
+                 elapsed);
+    if (estimated) {
+      std::fprintf(file, "%.1f}\n", remaining);
+    } else {
+      std::fprintf(file, "null}\n");
+    }
+    std::fflush(file);
+  }
+
+  std::string summary =
+      to_hms(pass.seconds) + " (" +
+      to_commastring(static_cast<std::size_t>(expandRate), 0) +
+      " positions expanded/s";
+  if (pass.scanBytes) {
+    summary += ", " +
+               to_commastring(static_cast<std::size_t>(scanRate) >> 20, 0) +
+               " MB/s scanned";
+  }
+  if (pass.diskBytes) {
+    summary += ", " +
+               to_commastring(static_cast<std::size_t>(diskRate) >> 20, 0) +
+               " MB/s to disk";
+  }
+  summary += ")";
+  if (estimated && pass.nUnreached) {
+    summary += "; about " + to_hms(remaining) + " to go";
+  }
+  return summary;
+}
+
+} // namespace Janus
@@ -0,0 +1,81 @@
+// Copyright (C) 2022 Greg Dionne
+// Distributed under MIT License
+#ifndef JANUS_BUILDTELEMETRY_HPP
+#define JANUS_BUILDTELEMETRY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace Janus {
+
+// Measurements of each pass of a depth table build.
+//
+// Each pass is summarized for the console and, when a path is given,
+// also appended to that file as a line of JSON, e.g.:
+//
+//   {"pass":9,"kind":"expanding","seconds":12.5,"reached":512345678,
+//    "expanded":41906294,"expandRate":3352503.5,"scanBytes":5736588288,
+//    "scanRate":458927063.0,"diskBytes":0,"threadSeconds":[12.4,12.5],
+//    "unreached":10962345678,"elapsed":95.2,"remaining":267.4}
+//
+// "remaining" estimates the seconds left in the build by assuming the
+// unreached positions are reached at the rate of the last pass (null
+// when the pass reached nothing).
+class BuildTelemetry {
+public:
+  struct Pass {
+    uint8_t pass = 0;
+
+    // recursive, expanding, scattering, owning, searching or
+    // out-of-core
+    const char *kind = "";
+
+    double seconds = 0;
+
+    // positions the pass reached
+    std::size_t nReached = 0;
+
+    // positions the pass expanded (or searched from)
+    std::size_t nExpanded = 0;
+
+    // bytes of the table (or frontier) scanned sequentially
+    std::size_t scanBytes = 0;
+
+    // bytes read from and written to disk
+    std::size_t diskBytes = 0;
+
+    // time each thread was busy
+    std::vector<double> threadSeconds;
+
+    // positions still unreached after the pass
+    std::size_t nUnreached = 0;
+  };
+
+  // appends the passes to the file at the specified path, if any
+  explicit BuildTelemetry(const std::string &path);
+  ~BuildTelemetry();
+
+  BuildTelemetry(const BuildTelemetry &) = delete;
+  BuildTelemetry &operator=(const BuildTelemetry &) = delete;
+
+  // records a pass.  returns its summary for the console.
+  std::string record(const Pass &pass);
+
+  // true if the file couldn't be opened
+  bool failed() const { return !path.empty() && !file; }
+
+  const std::string &getPath() const { return path; }
+
+private:
+  const std::string path;
+  std::FILE *file = nullptr;
+
+  // seconds spent in the passes recorded so far
+  double elapsed = 0;
+};
+
+} // namespace Janus
+#endif
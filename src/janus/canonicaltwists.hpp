@@ -0,0 +1,77 @@
+// Copyright (C) 2022 Greg Dionne
+// Distributed under MIT License
+#ifndef JANUS_CANONICALTWISTS_HPP
+#define JANUS_CANONICALTWISTS_HPP
+
+#include "bitutils.hpp"
+#include "constants.hpp"
+
+#include <cstdint>
+
+namespace Janus {
+
+// The twists that may follow each twist of a canonical sequence,
+// as a mask with a bit per twist.
+//
+// A twist never follows one of the same face.  Opposite faces
+// commute, so only one order of each such pair is searched: a F, R or
+// U twist never immediately follows a B, L or D twist, respectively.
+// Any longer run of twists on one axis then either repeats a face or
+// reverses that order, and twists on different axes don't commute, so
+// a longer window would only drop sequences that reach a position by
+// a different route, i.e. distinct solutions.  The automaton's state
+// is therefore just the last twist.
+//
+// Something like:
+//
+//   for (uint32_t twists = canonicalTwists.after(lastTwist); twists;
+//        twists &= twists - 1) {
+//     uint8_t twist = canonicalTwists.first(twists);
+//     ...
+//   }
+class CanonicalTwists {
+public:
+  // state before any twist
+  static constexpr uint8_t start = nFaceTwists;
+
+  // masks of the quarter and half twists
+  static constexpr uint32_t quarterTwists = (1U << nQuarterTwists) - 1;
+  static constexpr uint32_t halfTwists =
+      ((1U << nFaceTwists) - 1) & ~quarterTwists;
+
+  constexpr CanonicalTwists() : successors() {
+    for (uint8_t last = 0; last <= start; ++last) {
+      for (uint8_t twist = 0; twist < nFaceTwists; ++twist) {
+        if (last == start ||
+            (last % 6 != twist % 6 && last % 3 != twist % 6)) {
+          successors[last] |= 1U << twist;
+        }
+      }
+    }
+  }
+
+  // twists that may follow the specified twist (or start)
+  uint32_t after(uint8_t twist) const { return successors[twist]; }
+
+  // the lowest twist of a (non-empty) mask
+  static uint8_t first(uint32_t twists) {
+    return static_cast<uint8_t>(countTrailingZeros(twists));
+  }
+
+  // gathers the twists of a mask, lowest first.  returns how many.
+  static uint8_t gather(uint32_t twists, uint8_t *gathered) {
+    uint8_t nTwists = 0;
+    for (; twists; twists &= twists - 1) {
+      gathered[nTwists++] = first(twists);
+    }
+    return nTwists;
+  }
+
+private:
+  uint32_t successors[nFaceTwists + 1];
+};
+
+constexpr CanonicalTwists canonicalTwists;
+
+} // namespace Janus
+#endif
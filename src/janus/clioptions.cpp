@@ -31,8 +31,255 @@ CLIOptions::CLIOptions()
           "word 'enaris' meaning 'without a nose'.  As the Roman god Janus "
           "is often depicted with a head with two opposing faces, it was "
           "befitting to liken the center cubies to the noses of each face "
-          "and to use Latin to specify table computation without the noses."} {
+          "and to use Latin to specify table computation without the noses."},
+      mmap{false, "mmap", nullptr,
+           "Map the saved depth table instead of reading it.",
+           "By default, Janus reads the entire depth table into memory before "
+           "solving.  The 'mmap' option maps the saved table file read-only "
+           "so that solving may start immediately; pages of the table are "
+           "read from disk as they are first needed.  The mapped pages are "
+           "shared with the operating system's file cache, so restarting "
+           "Janus (or running more than one copy) need not read the table "
+           "again.\n "
+           "If the table file is missing, compressed, or its header doesn't "
+           "match the requested options, Janus falls back to reading (or "
+           "building) the table as usual."},
+      populate{false, "populate", nullptr,
+               "Map the saved depth table and read it in up front.",
+               "Like 'mmap', but every page of the table is read in before "
+               "solving starts.  This avoids page faults during the first "
+               "solves at the expense of startup time.  The table is still "
+               "shared with the operating system's file cache."},
+      warmup{false, "warmup", nullptr,
+             "Map the saved depth table and read it in the background.",
+             "Like 'mmap', but a background thread reads the table in ahead "
+             "of the solver.  Solving may start immediately and becomes "
+             "faster as more of the table is read."},
+      share{false, "share", nullptr,
+            "Share one depth table among all Janus processes.",
+            "By default, each Janus process keeps its own private copy of "
+            "the depth table.  The 'share' option places the table in a "
+            "named shared memory segment instead.  The first process to "
+            "start loads (or builds) the table into the segment; later "
+            "processes attach to it read-only, waiting until the table is "
+            "complete.  Running several servers then costs the memory of a "
+            "single table.\n "
+            "The segment remains after the last process exits so that "
+            "restarts need not reload the table.  On Linux it appears under "
+            "/dev/shm, which must be large enough to hold the table, and may "
+            "be removed there when no longer needed."},
+      hugepages{false, "hugepages", nullptr,
+                "Allocate the depth table with huge pages.",
+                "Lookups into the depth table are scattered throughout many "
+                "gigabytes of memory.  With ordinary (4 KB) pages, nearly "
+                "every lookup misses the processor's address translation "
+                "cache as well as its data cache.  The 'hugepages' option "
+                "allocates the table with 1 GB or 2 MB pages when the system "
+                "has reserved them (e.g. via /proc/sys/vm/nr_hugepages), "
+                "otherwise it asks for transparent huge pages.  The page "
+                "size obtained is reported at startup.  The option applies "
+                "both when building and when solving.\n "
+                "When combined with 'share', the shared segment is advised "
+                "to use transparent huge pages, which only has an effect "
+                "when the system enables them for shared memory."},
+      interleave{false, "interleave", nullptr,
+                 "Interleave the depth table across NUMA nodes.",
+                 "On hosts with more than one processor socket (NUMA node), "
+                 "memory attached to another socket is slower to read.  By "
+                 "default the depth table is placed wherever it is first "
+                 "written.  The 'interleave' option spreads the pages of the "
+                 "table evenly across all nodes so that no single memory "
+                 "controller becomes a bottleneck.  Solver and builder "
+                 "threads are also pinned (round-robin) to nodes.\n "
+                 "This option only has an effect on multi-node Linux hosts."},
+      replicate{false, "replicate", nullptr,
+                "Replicate the depth table on each NUMA node.",
+                "On hosts with more than one processor socket (NUMA node), "
+                "the 'replicate' option makes a copy of the depth table in "
+                "the memory of each node once it is loaded or built.  Solver "
+                "threads are pinned (round-robin) to nodes and read only "
+                "their node's copy.  This requires one additional table's "
+                "worth of memory per node; if there is not enough memory "
+                "available, the table is not replicated.\n "
+                "This option only has an effect on multi-node Linux hosts."},
+      direct{false, "direct", nullptr,
+             "Bypass the file cache when reading or writing the depth table.",
+             "The depth table is read and written in 64 MB chunks by several "
+             "threads at once.  By default the transfers pass through the "
+             "operating system's file cache, which then holds a second copy "
+             "of the table that is never used again.  The 'direct' option "
+             "bypasses the cache (O_DIRECT on Linux), which is usually faster "
+             "on NVMe drives and leaves the cache for other uses.\n "
+             "This option has no effect with 'mmap', 'populate' or 'warmup', "
+             "which rely upon the file cache."},
+      stripe{"", "stripe", "dirs",
+             "Stripe the saved depth table across several directories.",
+             "By default the depth table is saved as a single file in the "
+             "current directory.  The 'stripe' option takes a comma-separated "
+             "list of directories (ideally on separate drives) and saves the "
+             "table as one file per directory.  Successive 64 MB chunks of "
+             "the table are kept in successive files so that all drives are "
+             "read (or written) at once.  For example:\n "
+             "  -stripe=/disk0,/disk1\n "
+             "saves the table as /disk0/<table>.1-of-2 and "
+             "/disk1/<table>.2-of-2.  The same directories must be given "
+             "to load the table again.  A striped table cannot be used "
+             "with 'mmap', 'populate' or 'warmup'."},
+      compress{false, "compress", nullptr,
+               "Compress the depth table when saving it.",
+               "Most positions lie within a move or two of the same depth, "
+               "so the saved depth table compresses well.  The 'compress' "
+               "option saves the table as independently compressed 1 MB "
+               "blocks.  When loading, Janus recognizes a compressed table "
+               "by its contents and decompresses the blocks in parallel "
+               "directly into memory, which is usually faster than reading "
+               "the uncompressed table from disk.\n "
+               "A compressed table is always saved as a single file and "
+               "cannot be used with 'mmap', 'populate', 'warmup', 'stripe' "
+               "or 'direct'."},
+      validate{false, "validate", nullptr,
+               "Validate the depth table whenever it is loaded.",
+               "A newly built depth table is always validated by counting "
+               "its positions and computing an order-dependent checksum "
+               "of every entry.  The 'validate' option performs the same "
+               "checks each time the table is loaded, mapped or attached.  "
+               "The table is scanned by every processor at once, so this "
+               "takes seconds rather than minutes.  A loaded, mapped or "
+               "attached table that fails validation is rebuilt (in "
+               "private memory for a mapped or attached table)."},
+      checkpoint{false, "checkpoint", nullptr,
+                 "Save the depth table after each pass while building it.",
+                 "Building the depth table takes many passes, the last of "
+                 "which take the longest.  The 'checkpoint' option saves the "
+                 "table after each pass as <table>.checkpoint in the current "
+                 "directory.  If the build is interrupted, the next build "
+                 "with 'checkpoint' verifies the checkpoint's block "
+                 "checksums and resumes after its last pass.  Each "
+                 "checkpoint is written to a temporary file that replaces "
+                 "the previous one only once it is complete.  The checkpoint "
+                 "is removed once the finished table is saved.\n "
+                 "Each checkpoint needs as much disk space as the table."},
+      inplace{false, "inplace", nullptr,
+              "Build the depth table directly in its file.",
+              "By default the depth table is built in memory and saved "
+              "once it is finished.  The 'inplace' option builds the table "
+              "in a read-write mapping of the table file instead.  Pages "
+              "are written back to the file after each pass, so the "
+              "finished table is already on disk: there's no final save "
+              "that can fail, and the table isn't held in memory and the "
+              "file cache at once.  Until the build finishes, the file's "
+              "header marks it as unfinished.\n "
+              "This option has no effect with 'stripe', 'compress' or "
+              "'share', or on systems without memory mapping."},
+      threads{"", "threads", "n",
+              "Number of threads used to build the depth table.",
+              "Each pass of the depth table build is split into over a "
+              "thousand chunks that threads claim one at a time until none "
+              "remain, so threads that land on sparse regions of the table "
+              "simply take more chunks.  By default one thread is started "
+              "per processor.  The 'threads' option sets the number of "
+              "threads instead, e.g.:\n "
+              "  -threads=64\n "
+              "After each pass, the range of chunks and busy time over all "
+              "threads is reported."},
+      buildmode{"", "buildmode", "mode",
+                "How build passes update the depth table.",
+                "Most passes of the depth table build expand every position "
+                "reached by the previous pass and mark its unreached "
+                "neighbors, which lie all over the table.  The 'buildmode' "
+                "option selects how:\n "
+                "  -buildmode=direct   each thread marks neighbors as it "
+                "finds them (the default)\n "
+                "  -buildmode=scatter  neighbors are gathered into buckets "
+                "by 1 MB region of the table, then each region is marked by "
+                "a single thread\n "
+                "  -buildmode=owner    each thread owns every n-th 10 MB "
+                "region of the table, expands the positions within its "
+                "regions and sends neighbors in other regions to their "
+                "owners\n "
+                "Scattering trades a second pass over the gathered neighbors "
+                "for cache-friendly writes without atomic operations.  It "
+                "buffers up to 768 MB of neighbors at a time.  Owning avoids "
+                "both the atomic operations and the second pass, but threads "
+                "can't share the work of a busy region.  Both report exact "
+                "counts."},
+      altdepth{"", "altdepth", "n",
+               "Number of passes built recursively from home.",
+               "The first passes of the depth table build reach few "
+               "positions, so rather than scanning the whole table they "
+               "recurse from the home position, splitting the recursion "
+               "across threads a few twists from home.  Each pass recurses "
+               "through all the passes before it, so deeper passes are "
+               "better scanned.  The 'altdepth' option sets how many passes "
+               "recurse (7 by default), e.g.:\n "
+               "  -altdepth=8"},
+      shardsize{"", "shardsize", "MB",
+                "Build the depth table out of core in shards of this size.",
+                "By default the depth table is built in memory, which needs "
+                "more memory than the table itself.  The 'shardsize' option "
+                "builds the table directly in its file instead, holding only "
+                "one shard of the table in memory at a time, e.g.:\n "
+                "  -shardsize=4096\n "
+                "Each pass expands the shards the previous pass reached one "
+                "at a time, spilling neighbors that lie in other shards to "
+                "sorted files next to the table, then reads each shard back "
+                "in to mark the neighbors spilled to it.  The build needs "
+                "about twice the shard size in memory (rounded down to a "
+                "multiple of 64 MB), and free disk space for the table, half "
+                "as much again, and the spill files of the largest pass.  "
+                "The finished table is validated a shard at a time and then "
+                "mapped (as with 'mmap') rather than read in.\n "
+                "This option has no effect with 'stripe', 'compress' or "
+                "'share'."},
+      telemetry{"", "telemetry", "path",
+                "Append measurements of each build pass to this file.",
+                "Each pass of the depth table build reports how long it "
+                "took, how many positions it expanded per second, how fast "
+                "it scanned the table and wrote to disk, and roughly how "
+                "long the rest of the build should take.  The 'telemetry' "
+                "option also appends each pass to a file as a line of JSON, "
+                "e.g.:\n "
+                "  -telemetry=build.jsonl\n "
+                "Each line holds the pass number, kind, seconds, positions "
+                "reached and expanded (with their rate), bytes scanned and "
+                "bytes read from or written to disk (with their rates), the "
+                "seconds each thread was busy, the positions still "
+                "unreached, the seconds elapsed and the estimated seconds "
+                "remaining."},
+      streams{"", "streams", "n",
+              "Number of searches each solver thread interleaves.",
+              "Long searches are split into thousands of subtrees that "
+              "solver threads take one at a time.  Nearly every position a "
+              "thread visits reads three random entries of the depth "
+              "table, so a thread searching one subtree spends most of its "
+              "time waiting on memory.  The 'streams' option has each "
+              "thread search several subtrees at once, visiting one "
+              "position of each in turn while the table entries of the "
+              "others are fetched, e.g.:\n "
+              "  -streams=8\n "
+              "By default (or with 1) each thread searches one subtree at "
+              "a time recursively.  Searches short enough to run on a "
+              "single thread are unaffected."} {
   addOption(&qtm);
   addOption(&enares);
+  addOption(&mmap);
+  addOption(&populate);
+  addOption(&warmup);
+  addOption(&share);
+  addOption(&hugepages);
+  addOption(&interleave);
+  addOption(&replicate);
+  addOption(&direct);
+  addOption(&stripe);
+  addOption(&compress);
+  addOption(&validate);
+  addOption(&checkpoint);
+  addOption(&inplace);
+  addOption(&threads);
+  addOption(&buildmode);
+  addOption(&altdepth);
+  addOption(&shardsize);
+  addOption(&telemetry);
+  addOption(&streams);
 }
 } // namespace Janus
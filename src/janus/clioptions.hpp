@@ -13,6 +13,25 @@ public:
   CLIOptions();
   BinaryOption qtm;
   BinaryOption enares;
+  BinaryOption mmap;
+  BinaryOption populate;
+  BinaryOption warmup;
+  BinaryOption share;
+  BinaryOption hugepages;
+  BinaryOption interleave;
+  BinaryOption replicate;
+  BinaryOption direct;
+  ValueOption stripe;
+  BinaryOption compress;
+  BinaryOption validate;
+  BinaryOption checkpoint;
+  BinaryOption inplace;
+  ValueOption threads;
+  ValueOption buildmode;
+  ValueOption altdepth;
+  ValueOption shardsize;
+  ValueOption telemetry;
+  ValueOption streams;
 };
 
 } // namespace Janus
@@ -3,6 +3,8 @@
 #ifndef JANUS_CUBE
 #define JANUS_CUBE
 
+#include <future>
+#include <memory>
 #include <utility>
 
 #include "fullcube.hpp"
@@ -17,12 +19,12 @@ public:
   // initialize tables and make a cube in it's solved state
   Cube(const CLIOptions &options,
        std::function<void(const std::string &)> console,
-       std::function<bool(uint8_t *, std::size_t)> load,
-       std::function<bool(const uint8_t *, std::size_t)> save)
-      : moveTable(MoveTableBuilder(options).build()),
-        solver(std::make_unique<Solver>(options, moveTable.get(), console, load,
-                                        save)),
-        janusCube{JanusCube::home(solver.get())}, cubeParity(0) {}
+       const std::string &filename,
+       std::function<bool(uint8_t *, std::size_t, std::size_t)> load,
+       std::function<bool(const uint8_t *, std::size_t, std::size_t)>
+           save)
+      : Cube(options, std::make_shared<MoveTableBuilder>(options),
+             std::move(console), filename, std::move(load), std::move(save)) {}
 
   // reset the cube to its initial state
   void reset() {
@@ -58,9 +60,32 @@ public:
   }
 
 private:
+  // fills the move table while the depth table is read
+  Cube(const CLIOptions &options, std::shared_ptr<MoveTableBuilder> builder,
+       std::function<void(const std::string &)> console,
+       const std::string &filename,
+       std::function<bool(uint8_t *, std::size_t, std::size_t)> load,
+       std::function<bool(const uint8_t *, std::size_t, std::size_t)>
+           save)
+      : moveTable(builder->allocate()),
+        moveTableBuilt(std::async(std::launch::async,
+                                  [builder, table = moveTable.get()]() {
+                                    builder->fill(*table);
+                                  })
+                           .share()),
+        solver(std::make_unique<Solver>(options, moveTable.get(),
+                                        moveTableBuilt, console, filename,
+                                        load, save)),
+        janusCube{JanusCube::home(solver.get())}, cubeParity(0) {
+    moveTableBuilt.get();
+  }
+
   // table for performing moves
   const std::unique_ptr<MoveTable> moveTable;
 
+  // ready once the move table is filled
+  std::shared_future<void> moveTableBuilt;
+
   // solver
   std::unique_ptr<Solver> solver;
 
@@ -0,0 +1,159 @@
+// Copyright (C) 2022 Greg Dionne
+// Distributed under MIT License
+#include "depthscan.hpp"
+#include "bitutils.hpp"
+
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define JANUS_DEPTHSCAN_X86
+#include <immintrin.h>
+#endif
+
+namespace Janus {
+
+// An entry holds the depth when its two bits, exclusive-or'd with the
+// depth, are both zero.  For every byte (or word) the low bit of each
+// such entry is then set in
+//   ~(x | x >> 1) & 0x55
+// where x is the byte exclusive-or'd with the depth in every entry.
+// Shifting whole words lets a bit of the next byte into the top bit
+// of each byte, but the mask discards it.
+static const uint8_t lowBits = 0x55;
+
+// the depth repeated in all four entries of a byte
+static uint8_t repeat(uint8_t depth) {
+  return static_cast<uint8_t>(depth * lowBits);
+}
+
+// low bits of the entries in the byte that hold the depth
+static unsigned matches(uint8_t byte, uint8_t depth) {
+  unsigned x = byte ^ repeat(depth);
+  return ~(x | x >> 1) & lowBits;
+}
+
+// each kernel returns the offset of the first of n bytes holding an
+// entry with the depth, or n if there is none
+
+static std::size_t findByteScalar(const uint8_t *bytes, std::size_t n,
+                                  uint8_t depth) {
+  const uint64_t pattern = 0x0101010101010101ULL * repeat(depth);
+  const uint64_t low = 0x0101010101010101ULL * lowBits;
+
+  std::size_t offset = 0;
+  for (; offset + 8 <= n; offset += 8) {
+    uint64_t x;
+    std::memcpy(&x, bytes + offset, sizeof(x));
+    x ^= pattern;
+    uint64_t found = ~(x | x >> 1) & low;
+    if (found) {
+      // assumes a little-endian host, as the table files do
+      return offset + countTrailingZeros(found) / 8;
+    }
+  }
+  for (; offset < n; ++offset) {
+    if (matches(bytes[offset], depth)) {
+      return offset;
+    }
+  }
+  return n;
+}
+
+#ifdef JANUS_DEPTHSCAN_X86
+
+__attribute__((target("avx2"))) static std::size_t
+findByteAVX2(const uint8_t *bytes, std::size_t n, uint8_t depth) {
+  const __m256i pattern = _mm256_set1_epi8(static_cast<char>(repeat(depth)));
+  const __m256i low = _mm256_set1_epi8(static_cast<char>(lowBits));
+  const __m256i zero = _mm256_setzero_si256();
+
+  std::size_t offset = 0;
+  for (; offset + 32 <= n; offset += 32) {
+    __m256i x = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(bytes + offset));
+    x = _mm256_xor_si256(x, pattern);
+    __m256i found =
+        _mm256_andnot_si256(_mm256_or_si256(x, _mm256_srli_epi16(x, 1)), low);
+    auto empty = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(found, zero)));
+    if (empty != 0xFFFFFFFFU) {
+      return offset + countTrailingZeros(~empty);
+    }
+  }
+  return offset + findByteScalar(bytes + offset, n - offset, depth);
+}
+
+__attribute__((target("avx512f,avx512bw"))) static std::size_t
+findByteAVX512(const uint8_t *bytes, std::size_t n, uint8_t depth) {
+  const __m512i pattern = _mm512_set1_epi8(static_cast<char>(repeat(depth)));
+  const __m512i low = _mm512_set1_epi8(static_cast<char>(lowBits));
+
+  std::size_t offset = 0;
+  for (; offset + 64 <= n; offset += 64) {
+    __m512i x = _mm512_loadu_si512(bytes + offset);
+    x = _mm512_xor_si512(x, pattern);
+    __m512i either =
+        _mm512_and_si512(_mm512_or_si512(x, _mm512_srli_epi16(x, 1)), low);
+    uint64_t hits = _mm512_cmpneq_epi8_mask(either, low);
+    if (hits) {
+      return offset + countTrailingZeros(hits);
+    }
+  }
+  return offset + findByteScalar(bytes + offset, n - offset, depth);
+}
+
+#endif
+
+struct Kernel {
+  std::size_t (*findByte)(const uint8_t *, std::size_t, uint8_t);
+  const char *name;
+};
+
+static Kernel selectKernel() {
+#ifdef JANUS_DEPTHSCAN_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+    return {findByteAVX512, "avx512"};
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return {findByteAVX2, "avx2"};
+  }
+#endif
+  return {findByteScalar, "scalar"};
+}
+
+static const Kernel kernel = selectKernel();
+
+std::size_t findDepth(const uint8_t *table, std::size_t begin,
+                      std::size_t end, uint8_t depth) {
+
+  // entries before the first whole byte
+  for (; begin < end && (begin & 3); ++begin) {
+    if (((table[begin >> 2] >> ((begin & 3) << 1)) & 0x3) == depth) {
+      return begin;
+    }
+  }
+
+  // whole bytes
+  std::size_t loc = begin >> 2;
+  std::size_t stop = end >> 2;
+  if (loc < stop) {
+    loc += kernel.findByte(table + loc, stop - loc, depth);
+    if (loc < stop) {
+      return (loc << 2) + countTrailingZeros(matches(table[loc], depth)) / 2;
+    }
+    begin = stop << 2;
+  }
+
+  // entries after the last whole byte
+  for (; begin < end; ++begin) {
+    if (((table[begin >> 2] >> ((begin & 3) << 1)) & 0x3) == depth) {
+      return begin;
+    }
+  }
+  return end;
+}
+
+const char *depthScanKernel() { return kernel.name; }
+
+} // namespace Janus
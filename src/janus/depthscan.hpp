@@ -0,0 +1,35 @@
+// Copyright (C) 2022 Greg Dionne
+// Distributed under MIT License
+#ifndef JANUS_DEPTHSCAN_HPP
+#define JANUS_DEPTHSCAN_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Janus {
+
+// Searches a table of two-bit depths (four entries per byte, lowest
+// bits first) for entries holding a given depth.
+//
+// Late in a build nearly every byte of the table holds no entry of
+// interest, so whole bytes are tested 64 (AVX-512), 32 (AVX2) or 8
+// at a time, skipping straight to the next byte that holds a match.
+// The widest kernel the processor supports is chosen at run time.
+//
+// Something like:
+//
+//   for (auto idx = findDepth(table, begin, end, depth); idx < end;
+//        idx = findDepth(table, idx + 1, end, depth)) {
+//     ...
+//   }
+
+// returns the index of the first entry in [begin, end) that holds the
+// specified depth, or end if there is none.
+std::size_t findDepth(const uint8_t *table, std::size_t begin,
+                      std::size_t end, uint8_t depth);
+
+// name of the kernel chosen for this processor
+const char *depthScanKernel();
+
+} // namespace Janus
+#endif
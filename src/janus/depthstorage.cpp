@@ -0,0 +1,663 @@
+// Copyright (C) 2022 Greg Dionne
+// Distributed under MIT License
+#include "depthstorage.hpp"
+#include "strutils.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <utility>
+
+// memory mapping is only supported on POSIX systems
+#if !defined(_MSC_VER) && !defined(__MINGW32__) && !defined(__MINGW64__)
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define JANUS_HAS_MMAP
+#endif
+
+namespace Janus {
+
+std::unique_ptr<DepthStorage> DepthStorage::makeDepthStorage(
+    const CLIOptions &options, const std::string &filename,
+    const DepthTableHeader &expected,
+    const std::function<void(const std::string &)> &console, bool outOfCore) {
+
+  std::size_t nBytes = expected.getNBytes();
+
+  if (outOfCore || options.mmap.isEnabled() || options.populate.isEnabled() ||
+      options.warmup.isEnabled()) {
+
+    auto mode = options.populate.isEnabled() ? MappedStorage::Mode::populate
+                : options.warmup.isEnabled() ? MappedStorage::Mode::warmup
+                                             : MappedStorage::Mode::lazy;
+
+    auto mapped =
+        std::make_unique<MappedStorage>(filename, expected, mode, console);
+    if (mapped->isPopulated()) {
+      return std::unique_ptr<DepthStorage>(std::move(mapped));
+    }
+
+    if (outOfCore) {
+      return std::unique_ptr<DepthStorage>(
+          std::make_unique<OutOfCoreStorage>(nBytes));
+    }
+
+    console("unable to map " + filename + "; loading into memory instead\n");
+  }
+
+  if (options.share.isEnabled()) {
+    auto shared = std::make_unique<SharedStorage>(
+        SharedStorage::segmentName(filename), nBytes,
+        options.hugepages.isEnabled(), console);
+    if (shared->isPopulated() || shared->isOwner()) {
+      return std::unique_ptr<DepthStorage>(std::move(shared));
+    }
+
+    console("unable to share the depth table; "
+            "using private memory instead\n");
+  }
+
+  if (options.hugepages.isEnabled()) {
+    auto huge = std::make_unique<HugePageStorage>(nBytes);
+    if (huge->pageSize()) {
+      console("allocated depth table using " +
+              (huge->isTransparent()
+                   ? std::string("transparent huge pages (if available)")
+                   : to_commastring(huge->pageSize() >> 10, 0) +
+                         " KB pages") +
+              "\n");
+      return std::unique_ptr<DepthStorage>(std::move(huge));
+    }
+
+    console("unable to allocate huge pages; using regular pages instead\n");
+  }
+
+  return std::unique_ptr<DepthStorage>(std::make_unique<HeapStorage>(nBytes));
+}
+
+std::unique_ptr<DepthStorage>
+DepthStorage::makePrivateStorage(std::size_t nBytes, bool hugePages) {
+  if (hugePages) {
+    auto huge = std::make_unique<HugePageStorage>(nBytes);
+    if (huge->pageSize()) {
+      return std::unique_ptr<DepthStorage>(std::move(huge));
+    }
+  }
+
+  return std::unique_ptr<DepthStorage>(std::make_unique<HeapStorage>(nBytes));
+}
+
+// the table is always loaded or cleared before use, so it's
+// left uninitialized.  This avoids touching every page twice and
+// leaves page placement to whoever writes to it first.
+HeapStorage::HeapStorage(std::size_t n)
+    : DepthStorage(n), atomicBytes(new std::atomic_uint8_t[n]) {
+  bytes = const_cast<uint8_t *>(
+      reinterpret_cast<const uint8_t *>(&atomicBytes.get()[0]));
+}
+
+#ifdef JANUS_HAS_MMAP
+
+HugePageStorage::HugePageStorage(std::size_t n) : DepthStorage(n) {
+
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+  // try the largest pages first
+  const std::size_t gigabyte = static_cast<std::size_t>(1) << 30;
+  const std::size_t twoMegabytes = static_cast<std::size_t>(2) << 20;
+  if (mapExplicit(gigabyte) || mapExplicit(twoMegabytes)) {
+    return;
+  }
+#endif
+
+  void *addr = mmap(nullptr, n, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (addr == MAP_FAILED) {
+    return;
+  }
+
+  mapping = addr;
+  mappingSize = n;
+  bytes = static_cast<uint8_t *>(addr);
+  obtainedPageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+
+#ifdef MADV_HUGEPAGE
+  if (madvise(mapping, mappingSize, MADV_HUGEPAGE) == 0) {
+    transparent = true;
+  }
+#endif
+}
+
+HugePageStorage::~HugePageStorage() {
+  if (mapping) {
+    munmap(mapping, mappingSize);
+  }
+}
+
+bool HugePageStorage::mapExplicit(std::size_t hugePageSize) {
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+  // mappings must be a whole number of pages
+  std::size_t size = (nBytes + hugePageSize - 1) / hugePageSize * hugePageSize;
+
+  int log2PageSize = 0;
+  while ((static_cast<std::size_t>(1) << log2PageSize) < hugePageSize) {
+    ++log2PageSize;
+  }
+
+  void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB |
+                        (log2PageSize << MAP_HUGE_SHIFT),
+                    -1, 0);
+  if (addr == MAP_FAILED) {
+    return false;
+  }
+
+  mapping = addr;
+  mappingSize = size;
+  bytes = static_cast<uint8_t *>(addr);
+  obtainedPageSize = hugePageSize;
+  return true;
+#else
+  (void)hugePageSize;
+  return false;
+#endif
+}
+
+MappedStorage::MappedStorage(const std::string &filename,
+                             const DepthTableHeader &expected, Mode mode,
+                             std::function<void(const std::string &)> console)
+    : DepthStorage(expected.getNBytes()), consoleOut(std::move(console)) {
+
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return;
+  }
+
+  // only map an uncompressed table of the expected kind and size
+  const std::size_t n = nBytes + DepthTableHeader::size;
+  uint8_t page[DepthTableHeader::size];
+  DepthTableHeader found(expected);
+  struct stat st;
+  if (fstat(fd, &st) == -1 || static_cast<std::size_t>(st.st_size) != n ||
+      pread(fd, page, sizeof(page), 0) != static_cast<ssize_t>(sizeof(page)) ||
+      !found.read(page) || !found.mismatch(expected).empty() ||
+      found.getFormat() != DepthTableHeader::Format::raw) {
+    close(fd);
+    return;
+  }
+
+  int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+  if (mode == Mode::populate) {
+    consoleOut("mapping " + filename + " (populating)... ");
+    flags |= MAP_POPULATE;
+  }
+#endif
+
+  void *addr = mmap(nullptr, n, PROT_READ, flags, fd, 0);
+
+  // the mapping holds its own reference to the file
+  close(fd);
+
+  if (addr == MAP_FAILED) {
+    return;
+  }
+
+  // the table follows the header
+  mapping = addr;
+  mappingSize = n;
+  bytes = static_cast<uint8_t *>(addr) + DepthTableHeader::size;
+  populated = true;
+
+  if (mode == Mode::lazy) {
+    // lookups are scattered throughout the table, so readahead on a
+    // page fault is wasted effort.
+    madvise(mapping, mappingSize, MADV_RANDOM);
+  }
+
+  if (mode == Mode::populate) {
+    consoleOut("done\n");
+  }
+
+  if (mode == Mode::warmup) {
+    warmupThread = std::thread(&MappedStorage::warmup, this);
+  }
+}
+
+MappedStorage::~MappedStorage() {
+  cancelWarmup = true;
+  if (warmupThread.joinable()) {
+    warmupThread.join();
+  }
+
+  if (mapping) {
+    munmap(mapping, mappingSize);
+  }
+}
+
+void MappedStorage::warmup() {
+
+  // ask for one gigabyte at a time so a cancellation isn't held up
+  const std::size_t chunkSize = static_cast<std::size_t>(1) << 30;
+  const auto pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+
+  volatile uint8_t sink = 0;
+
+  for (std::size_t offset = 0; offset < nBytes && !cancelWarmup;
+       offset += chunkSize) {
+    std::size_t length = std::min(chunkSize, nBytes - offset);
+    madvise(bytes + offset, length, MADV_WILLNEED);
+
+    // touch each page so the solver doesn't have to fault it in
+    for (std::size_t page = 0; page < length; page += pageSize) {
+      sink = sink + bytes[offset + page];
+    }
+  }
+
+  if (!cancelWarmup) {
+    consoleOut("depth table warm-up complete (" +
+               to_commastring(nBytes, 0) + " bytes)\n");
+  }
+}
+
+FileStorage::FileStorage(const std::string &filename, std::size_t n)
+    : DepthStorage(n) {
+
+  int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1) {
+    return;
+  }
+
+  // reserve the disk space up front; running out of it while writing
+  // back the mapping would raise SIGBUS.  (the zeroed header page
+  // isn't mistaken for a table.)
+  const std::size_t size = DepthTableHeader::size + n;
+  if (posix_fallocate(fd, 0, static_cast<off_t>(size)) != 0) {
+    close(fd);
+    return;
+  }
+
+  void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  // the mapping holds its own reference to the file
+  close(fd);
+
+  if (addr == MAP_FAILED) {
+    return;
+  }
+
+  mapping = addr;
+  mappingSize = size;
+  bytes = static_cast<uint8_t *>(addr) + DepthTableHeader::size;
+  fileBacked = true;
+}
+
+FileStorage::~FileStorage() {
+  if (mapping) {
+    munmap(mapping, mappingSize);
+  }
+}
+
+void FileStorage::flush(const uint8_t *headerPage) {
+  std::copy(headerPage, headerPage + DepthTableHeader::size,
+            static_cast<uint8_t *>(mapping));
+  msync(mapping, mappingSize, MS_ASYNC);
+}
+
+bool FileStorage::commit(const uint8_t *headerPage) {
+  // the table must be complete before the header says so
+  if (msync(mapping, mappingSize, MS_SYNC) == -1) {
+    return false;
+  }
+  std::copy(headerPage, headerPage + DepthTableHeader::size,
+            static_cast<uint8_t *>(mapping));
+  return msync(mapping, DepthTableHeader::size, MS_SYNC) == 0;
+}
+
+// control block at the start of a shared segment
+struct SharedStorage::ControlBlock {
+  constexpr static uint32_t magicNumber = 0xECAFFACE;
+
+  // segment states.  the creator fills in the block (marking it
+  // sizing) before growing the segment to hold the table.
+  constexpr static uint32_t unset = 0;
+  constexpr static uint32_t sizing = 1;
+  constexpr static uint32_t loading = 2;
+  constexpr static uint32_t ready = 3;
+  constexpr static uint32_t withdrawn = 4;
+
+  uint32_t magic;
+  uint32_t pid; // creating process
+  uint64_t nBytes;
+  std::atomic<uint32_t> state;
+};
+
+// size reserved for the control block (keeps the table page-aligned)
+static const std::size_t controlSize = 4096;
+
+std::string SharedStorage::segmentName(const std::string &filename) {
+  // use the base name of the file without its extension.
+  // (some systems limit segment names to 31 characters)
+  auto base = filename.substr(filename.find_last_of('/') + 1);
+  return "/" + base.substr(0, base.find_last_of('.'));
+}
+
+SharedStorage::SharedStorage(const std::string &name, std::size_t n,
+                             bool hugePages,
+                             std::function<void(const std::string &)> console)
+    : DepthStorage(n), segment(name), useHugePages(hugePages),
+      mappingSize(controlSize + n), consoleOut(std::move(console)) {
+
+  // a segment abandoned by a crashed process is removed and
+  // recreated, so allow a few tries.
+  for (int attempt = 0; attempt < 3; ++attempt) {
+    if (create()) {
+      consoleOut("created shared depth table " + segment + "\n");
+      owner = true;
+      return;
+    }
+
+    if (errno != EEXIST) {
+      return;
+    }
+
+    switch (attach()) {
+    case Attached::ready:
+      consoleOut("attached to shared depth table " + segment + "\n");
+      populated = true;
+      return;
+
+    case Attached::abandoned:
+      // only once its creator is known to be gone
+      consoleOut("removing abandoned shared depth table " + segment + "\n");
+      shm_unlink(segment.c_str());
+      break;
+
+    case Attached::withdrawn:
+      // its creator has already removed it
+      break;
+
+    case Attached::unusable:
+      consoleOut("couldn't use shared depth table " + segment + "\n");
+      return;
+    }
+  }
+}
+
+SharedStorage::~SharedStorage() {
+  // the segment itself is left for other (and future) processes
+  if (mapping) {
+    munmap(mapping, mappingSize);
+  }
+}
+
+bool SharedStorage::create() {
+  int fd = shm_open(segment.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd == -1) {
+    return false;
+  }
+
+  // claim the segment before sizing it, so that processes attaching
+  // meanwhile know whom to wait for
+  void *addr = MAP_FAILED;
+  if (ftruncate(fd, static_cast<off_t>(controlSize)) == 0) {
+    addr = mmap(nullptr, controlSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                0);
+  }
+  if (addr == MAP_FAILED) {
+    int savedErrno = errno;
+    close(fd);
+    shm_unlink(segment.c_str());
+    errno = savedErrno == EEXIST ? ENOMEM : savedErrno;
+    return false;
+  }
+
+  auto *block = static_cast<ControlBlock *>(addr);
+  block->magic = ControlBlock::magicNumber;
+  block->pid = static_cast<uint32_t>(getpid());
+  block->nBytes = nBytes;
+  block->state.store(ControlBlock::sizing, std::memory_order_release);
+
+  int result = ftruncate(fd, static_cast<off_t>(mappingSize));
+
+#ifdef __linux__
+  // reserve the memory now rather than fault on a full /dev/shm later
+  if (result == 0) {
+    result = posix_fallocate(fd, 0, static_cast<off_t>(mappingSize));
+    if (result != 0) {
+      errno = result;
+      result = -1;
+    }
+  }
+#endif
+
+  void *table = MAP_FAILED;
+  if (result == 0) {
+    table = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                 0);
+  }
+
+#ifdef MADV_HUGEPAGE
+  // only effective when the system allows huge pages for shared memory
+  if (table != MAP_FAILED && useHugePages) {
+    madvise(table, mappingSize, MADV_HUGEPAGE);
+  }
+#endif
+
+  int savedErrno = errno;
+  close(fd);
+
+  if (table == MAP_FAILED) {
+    // let waiting processes retry rather than wait on us
+    block->state.store(ControlBlock::withdrawn, std::memory_order_release);
+    munmap(addr, controlSize);
+    shm_unlink(segment.c_str());
+    errno = savedErrno == EEXIST ? ENOMEM : savedErrno;
+    return false;
+  }
+  munmap(addr, controlSize);
+
+  mapping = table;
+  bytes = static_cast<uint8_t *>(table) + controlSize;
+
+  control = static_cast<ControlBlock *>(table);
+  control->state.store(ControlBlock::loading, std::memory_order_release);
+
+  return true;
+}
+
+SharedStorage::Attached SharedStorage::attach() {
+  int fd = shm_open(segment.c_str(), O_RDONLY, 0);
+  if (fd == -1) {
+    return Attached::withdrawn;
+  }
+
+  // the creator sizes and fills in the control block straight after
+  // creating the segment, so it is only waited for briefly.  (until
+  // then there is no process to check on.)
+  struct stat st;
+  void *addr = MAP_FAILED;
+  for (int wait = 0; wait < 100 && addr == MAP_FAILED; ++wait) {
+    if (fstat(fd, &st) == -1) {
+      break;
+    }
+    if (static_cast<std::size_t>(st.st_size) >= controlSize) {
+      addr = mmap(nullptr, controlSize, PROT_READ, MAP_SHARED, fd, 0);
+      if (addr == MAP_FAILED) {
+        break;
+      }
+      if (static_cast<ControlBlock *>(addr)->state.load(
+              std::memory_order_acquire) == ControlBlock::unset) {
+        munmap(addr, controlSize);
+        addr = MAP_FAILED;
+      }
+    }
+    if (addr == MAP_FAILED) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+  }
+
+  if (addr == MAP_FAILED) {
+    close(fd);
+    return Attached::unusable;
+  }
+
+  // wait for the creator to publish the table, for as long as it runs
+  auto *block = static_cast<ControlBlock *>(addr);
+  bool creatorRunning = true;
+  bool reported = false;
+  uint32_t state = block->state.load(std::memory_order_acquire);
+  while (state == ControlBlock::sizing || state == ControlBlock::loading) {
+    if (kill(static_cast<pid_t>(block->pid), 0) == -1 && errno == ESRCH) {
+      creatorRunning = false;
+      break;
+    }
+    if (!reported) {
+      consoleOut("waiting for process " + std::to_string(block->pid) +
+                 " to publish shared depth table " + segment + "...\n");
+      reported = true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    state = block->state.load(std::memory_order_acquire);
+  }
+
+  bool compatible = block->magic == ControlBlock::magicNumber &&
+                    block->nBytes == nBytes;
+  auto pid = static_cast<pid_t>(block->pid);
+  munmap(addr, controlSize);
+
+  if (state == ControlBlock::withdrawn) {
+    close(fd);
+    return Attached::withdrawn;
+  }
+
+  // a segment we can't use may only be removed once its creator is
+  // gone (a published table outlives its creator)
+  if (!compatible || state != ControlBlock::ready) {
+    close(fd);
+    if (creatorRunning) {
+      creatorRunning = kill(pid, 0) == 0 || errno != ESRCH;
+    }
+    return creatorRunning ? Attached::unusable : Attached::abandoned;
+  }
+
+  // a published segment is fully sized
+  void *table = MAP_FAILED;
+  if (fstat(fd, &st) == 0 &&
+      static_cast<std::size_t>(st.st_size) == mappingSize) {
+    table = mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+    segmentDevice = static_cast<uint64_t>(st.st_dev);
+    segmentInode = static_cast<uint64_t>(st.st_ino);
+  }
+  close(fd);
+
+  if (table == MAP_FAILED) {
+    return Attached::unusable;
+  }
+
+#ifdef MADV_HUGEPAGE
+  if (useHugePages) {
+    madvise(table, mappingSize, MADV_HUGEPAGE);
+  }
+#endif
+
+  mapping = table;
+  control = static_cast<ControlBlock *>(table);
+  bytes = static_cast<uint8_t *>(table) + controlSize;
+
+  return Attached::ready;
+}
+
+void SharedStorage::publish() {
+  if (owner) {
+    control->state.store(ControlBlock::ready, std::memory_order_release);
+    consoleOut("published shared depth table " + segment + "\n");
+  }
+}
+
+void SharedStorage::withdraw() {
+  if (!populated) {
+    return;
+  }
+
+  // only remove the segment we attached to; another process may
+  // already have removed it and created a replacement
+  bool same = false;
+  int fd = shm_open(segment.c_str(), O_RDONLY, 0);
+  if (fd != -1) {
+    struct stat st;
+    same = fstat(fd, &st) == 0 &&
+           static_cast<uint64_t>(st.st_dev) == segmentDevice &&
+           static_cast<uint64_t>(st.st_ino) == segmentInode;
+    close(fd);
+  } else if (errno == ENOENT) {
+    return;
+  }
+
+  if (same && shm_unlink(segment.c_str()) == 0) {
+    consoleOut("removed damaged shared depth table " + segment + "\n");
+  } else if (same || fd == -1) {
+    consoleOut("couldn't remove damaged shared depth table " + segment +
+               "; please remove it from /dev/shm\n");
+  }
+}
+
+#else
+
+// huge pages unsupported; pageSize() reports failure
+HugePageStorage::HugePageStorage(std::size_t n) : DepthStorage(n) {}
+
+HugePageStorage::~HugePageStorage() = default;
+
+bool HugePageStorage::mapExplicit(std::size_t /*hugePageSize*/) {
+  return false;
+}
+
+// mapping unsupported; isPopulated() reports failure
+MappedStorage::MappedStorage(const std::string & /*filename*/,
+                             const DepthTableHeader &expected, Mode /*mode*/,
+                             std::function<void(const std::string &)> console)
+    : DepthStorage(expected.getNBytes()), consoleOut(std::move(console)) {}
+
+MappedStorage::~MappedStorage() = default;
+
+void MappedStorage::warmup() {}
+
+// mapping unsupported; data() reports failure
+FileStorage::FileStorage(const std::string & /*filename*/, std::size_t n)
+    : DepthStorage(n) {}
+
+FileStorage::~FileStorage() = default;
+
+void FileStorage::flush(const uint8_t * /*headerPage*/) {}
+
+bool FileStorage::commit(const uint8_t * /*headerPage*/) { return false; }
+
+// sharing unsupported; neither isPopulated() nor isOwner() is set
+struct SharedStorage::ControlBlock {};
+
+std::string SharedStorage::segmentName(const std::string &filename) {
+  return filename;
+}
+
+SharedStorage::SharedStorage(const std::string &name, std::size_t n,
+                             bool hugePages,
+                             std::function<void(const std::string &)> console)
+    : DepthStorage(n), segment(name), useHugePages(hugePages),
+      consoleOut(std::move(console)) {}
+
+SharedStorage::~SharedStorage() = default;
+
+bool SharedStorage::create() { return false; }
+
+SharedStorage::Attached SharedStorage::attach() { return Attached::unusable; }
+
+void SharedStorage::publish() {}
+
+void SharedStorage::withdraw() {}
+
+#endif
+
+} // namespace Janus
@@ -0,0 +1,262 @@
+// Copyright (C) 2022 Greg Dionne
+// Distributed under MIT License
+#ifndef JANUS_DEPTHSTORAGE_HPP
+#define JANUS_DEPTHSTORAGE_HPP
+
+#include "clioptions.hpp"
+#include "depthtableheader.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace Janus {
+
+// Backing memory for the depth table.
+//
+// By default the table lives in private heap memory and is
+// filled by the user's load callback (or built from scratch).
+//
+// A storage may instead arrive already populated, such as when
+// mapping a previously saved table file.  A populated storage
+// is read-only and needs neither loading nor building.
+
+class DepthStorage {
+public:
+  virtual ~DepthStorage() = default;
+
+  DepthStorage(const DepthStorage &) = delete;
+  DepthStorage &operator=(const DepthStorage &) = delete;
+
+  // raw view of the storage
+  uint8_t *data() const { return bytes; }
+
+  // atomic view of the storage (used when building the table)
+  std::atomic_uint8_t *atomicData() const {
+    return reinterpret_cast<std::atomic_uint8_t *>(bytes);
+  }
+
+  // number of bytes in the storage
+  std::size_t size() const { return nBytes; }
+
+  // true when the storage already holds a complete table
+  bool isPopulated() const { return populated; }
+
+  // invoked once an unpopulated storage has been loaded or built
+  virtual void publish() {}
+
+  // invoked when a populated storage fails validation, so that other
+  // processes stop being handed the damaged table
+  virtual void withdraw() {}
+
+  // true when the storage is the table file itself, so a table built
+  // in it needs no separate save
+  bool isFileBacked() const { return fileBacked; }
+
+  // starts writing a file-backed table (built through the pass the
+  // header page records) back to its file
+  virtual void flush(const uint8_t * /*headerPage*/) {}
+
+  // finishes a file-backed table with its (signed) header page, and
+  // waits for all of it to reach the file.  returns false on failure.
+  virtual bool commit(const uint8_t * /*headerPage*/) { return false; }
+
+  // utility creation
+  //   returns a read-only mapping of the table file (when its header
+  //   matches the expected one) or a shared memory segment when
+  //   requested (and possible), otherwise returns heap storage.
+  //   A table to be built out of core is mapped if it can be, and
+  //   otherwise gets no memory at all (data() is null).
+  static std::unique_ptr<DepthStorage>
+  makeDepthStorage(const CLIOptions &options, const std::string &filename,
+                   const DepthTableHeader &expected,
+                   const std::function<void(const std::string &)> &console,
+                   bool outOfCore = false);
+
+  // returns private (unpopulated) storage, using huge pages if requested
+  // and available.
+  static std::unique_ptr<DepthStorage> makePrivateStorage(std::size_t nBytes,
+                                                          bool hugePages);
+
+protected:
+  explicit DepthStorage(std::size_t n) : nBytes(n) {}
+
+  uint8_t *bytes = nullptr;
+  const std::size_t nBytes;
+  bool populated = false;
+  bool fileBacked = false;
+};
+
+// no memory at all, for a table built out of core and then mapped
+class OutOfCoreStorage : public DepthStorage {
+public:
+  explicit OutOfCoreStorage(std::size_t n) : DepthStorage(n) {}
+};
+
+// private heap memory (uninitialized)
+class HeapStorage : public DepthStorage {
+public:
+  explicit HeapStorage(std::size_t n);
+
+private:
+  std::unique_ptr<std::atomic_uint8_t[]> atomicBytes;
+};
+
+// private, zero-initialized memory backed by huge pages.
+//
+// Lookups into the table are scattered, so with ordinary pages nearly
+// every lookup misses the TLB as well as the cache.  Explicit 1 GB or
+// 2 MB pages are tried first (these must be reserved by the system
+// administrator), then transparent huge pages.  isPopulated() is never
+// set; pageSize() reports zero when no memory could be obtained.
+class HugePageStorage : public DepthStorage {
+public:
+  explicit HugePageStorage(std::size_t n);
+  ~HugePageStorage() override;
+
+  // size of the pages obtained (in bytes)
+  std::size_t pageSize() const { return obtainedPageSize; }
+
+  // true when the kernel was merely advised to use huge pages
+  bool isTransparent() const { return transparent; }
+
+private:
+  // try to map n bytes with explicit huge pages of the specified size
+  bool mapExplicit(std::size_t hugePageSize);
+
+  void *mapping = nullptr;
+  std::size_t mappingSize = 0;
+  std::size_t obtainedPageSize = 0;
+  bool transparent = false;
+};
+
+// read-only mapping of a saved table file.
+//
+// Pages are shared with the operating system's page cache, so
+// restarting a process (or running several) does not re-read the
+// file when it is still cached.
+//
+// Only an uncompressed file whose header matches the expected one is
+// mapped.  Its block checksums are not verified, since that would read
+// the entire table up front.
+class MappedStorage : public DepthStorage {
+public:
+  enum class Mode {
+    lazy,     // fault pages in as the solver touches them
+    populate, // fault every page in before returning (MAP_POPULATE)
+    warmup    // return immediately, but read ahead in the background
+  };
+
+  // maps the file. isPopulated() reports success.
+  MappedStorage(const std::string &filename, const DepthTableHeader &expected,
+                Mode mode, std::function<void(const std::string &)> console);
+  ~MappedStorage() override;
+
+private:
+  // advise and touch each page of the mapping in turn
+  void warmup();
+
+  void *mapping = nullptr;
+  std::size_t mappingSize = 0;
+
+  std::function<void(const std::string &)> consoleOut;
+
+  std::thread warmupThread;
+  std::atomic<bool> cancelWarmup{false};
+};
+
+// read-write mapping of the table file that the table is built in.
+//
+// Pages of the table are written back to the file as the build goes,
+// so the finished table is already on disk: there's no final save to
+// fail or stall, nor a second copy of the table in the file cache.
+// Until commit(), the header page marks the file as unfinished.
+//
+// The file is created (or replaced) when the storage is.
+class FileStorage : public DepthStorage {
+public:
+  // maps the file.  data() is null if it could not be.
+  FileStorage(const std::string &filename, std::size_t n);
+  ~FileStorage() override;
+
+  void flush(const uint8_t *headerPage) override;
+  bool commit(const uint8_t *headerPage) override;
+
+private:
+  void *mapping = nullptr;
+  std::size_t mappingSize = 0;
+};
+
+// shared memory segment visible to every Janus process on the host.
+//
+// The first process to create the segment populates it and publishes
+// it when complete.  Later processes attach read-only and wait for it
+// to be published.  The segment outlives the processes using it, so
+// restarts attach without reloading.
+//
+// The first page of the segment holds a small control block used as
+// the readiness handshake; the table itself follows.
+class SharedStorage : public DepthStorage {
+public:
+  // creates or attaches to the named segment. isPopulated() reports
+  // whether an attached segment is ready, isOwner() whether this process
+  // must populate a new segment.  If neither is true, the segment could
+  // not be used.
+  SharedStorage(const std::string &name, std::size_t n, bool hugePages,
+                std::function<void(const std::string &)> console);
+  ~SharedStorage() override;
+
+  // true when this process created the segment
+  bool isOwner() const { return owner; }
+
+  // make the table available to attached processes
+  void publish() override;
+
+  // remove a damaged segment so the next process creates a fresh one.
+  // (processes already attached keep their mapping.)
+  void withdraw() override;
+
+  // name of the segment for the specified table file
+  static std::string segmentName(const std::string &filename);
+
+private:
+  // try to create the segment
+  bool create();
+
+  // outcomes of attaching to an existing segment
+  enum class Attached {
+    ready,     // the table is published and mapped
+    abandoned, // its creator died before publishing it
+    withdrawn, // its creator removed it (or it is gone)
+    unusable   // it can't be used, but its creator may be using it
+  };
+
+  // try to attach to an existing segment, waiting for its creator
+  // to publish it
+  Attached attach();
+
+  struct ControlBlock;
+  ControlBlock *control = nullptr;
+
+  const std::string segment;
+
+  // advise the kernel to back the segment with huge pages
+  const bool useHugePages;
+
+  void *mapping = nullptr;
+  std::size_t mappingSize = 0;
+
+  // identity of the segment (so that withdraw() leaves a replacement be)
+  uint64_t segmentDevice = 0;
+  uint64_t segmentInode = 0;
+
+  bool owner = false;
+
+  std::function<void(const std::string &)> consoleOut;
+};
+
+} // namespace Janus
+#endif
@@ -3,16 +3,71 @@
 #include "depthtable.hpp"
 #include "bitutils.hpp"
 #include "constants.hpp"
+#include "depthscan.hpp"
 #include "index.hpp"
 #include "strutils.hpp"
+#include "utils/stripedfile.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <future>
 #include <mutex>
+#include <new>
 #include <numeric>
+#include <thread>
 #include <vector>
 
 namespace Janus {
 
+thread_local const uint8_t *DepthTable::localData = nullptr;
+
+// pin the calling thread to a node and read from its replica
+void DepthTable::bindThread(std::size_t thread) const {
+  if (numaAware) {
+    std::size_t node = thread % numaNodes.size();
+    numaNodes.bindThread(node);
+    localData = replicas.empty() ? nullptr : replicas[node]->data();
+  }
+}
+
+// copy the table to memory local to each NUMA node
+void DepthTable::replicate(bool hugePages) {
+  std::size_t nNodes = numaNodes.size();
+  std::size_t nBytes = nSymCoords / 4;
+
+  if (NumaNodes::availableMemory() < nNodes * nBytes) {
+    consoleOut("insufficient memory to replicate depth table on " +
+               std::to_string(nNodes) + " nodes\n");
+    return;
+  }
+
+  consoleOut("replicating depth table on " + std::to_string(nNodes) +
+             " nodes... ");
+
+  // each copy is made by a thread running on its node
+  std::vector<std::unique_ptr<DepthStorage>> copies(nNodes);
+  std::vector<std::future<void>> copiers(nNodes);
+  for (std::size_t node = 0; node < nNodes; ++node) {
+    copiers[node] = std::async(std::launch::async, [&, node]() {
+      numaNodes.bindThread(node);
+      copies[node] = DepthStorage::makePrivateStorage(nBytes, hugePages);
+      numaNodes.bind(copies[node]->data(), nBytes, node);
+      std::memcpy(copies[node]->data(), data, nBytes);
+    });
+  }
+
+  for (auto &copier : copiers) {
+    copier.get();
+  }
+
+  replicas = std::move(copies);
+
+  consoleOut("done\n");
+}
+
 // clear the table (single-threaded)
 void DepthTable::clear() {
 
@@ -32,9 +87,10 @@ std::size_t DepthTable::rbuild(const MoveTable *moveTable, std::size_t cidx,
   std::size_t idx = fullIdx(cidx, eidx);
   uint8_t tableDepth = getDepth(idx);
 
+  // other threads may reach the same positions, so claim them
+  // atomically.  a thread losing the claim counts as a later visit.
   if (!currentDepth) {
-    if (tableDepth == 0x3) {
-      setDepthNonAtomically(idx, depth % 3);
+    if (tableDepth == 0x3 && claimDepth(idx, depth % 3)) {
       return 1;
     }
 
@@ -45,8 +101,7 @@ std::size_t DepthTable::rbuild(const MoveTable *moveTable, std::size_t cidx,
       uint32_t epcidx = moveTable->cornerPermuteTable(p, cidx);
 
       std::size_t tidx = fullIdx(epcidx, epeidx);
-      if (getDepth(tidx) == 0x03) {
-        setDepthNonAtomically(tidx, depth % 3);
+      if (getDepth(tidx) == 0x03 && claimDepth(tidx, depth % 3)) {
         ++count;
       }
     }
@@ -70,25 +125,175 @@ std::size_t DepthTable::rbuild(const MoveTable *moveTable, std::size_t cidx,
       uint32_t peidx = teidx >> nEdgePermBits;
       uint32_t pcidx = moveTable->cornerPermuteTable(iPerm, tcidx);
 
-      // recurse another depth with the permuted cube
+      // recurse
       count += rbuild(moveTable, pcidx, peidx, depth, currentDepth - 1);
     }
   }
   return count;
 }
 
-// recursively build the table from the home coordinate down to the
-// specified depth (single-threaded)
+void DepthTable::rsplit(
+    const MoveTable *moveTable, std::size_t cidx, std::size_t eidx,
+    uint8_t depth, uint8_t currentDepth, uint8_t levels,
+    std::vector<std::pair<uint32_t, uint32_t>> &roots) const {
+
+  if (!levels) {
+    roots.emplace_back(cidx, eidx);
+    return;
+  }
+
+  // only recurse if we match the correct depth
+  if (getDepth(cidx, eidx) == (depth - currentDepth) % 3) {
+    for (int iTwist = 0; iTwist < nTwistsPerMove; ++iTwist) {
+      uint32_t tcidx = moveTable->cornerTwistTable(iTwist, cidx);
+      uint32_t teidx = moveTable->edgeTwistTable(iTwist, eidx);
+      uint8_t iPerm = teidx & edgePermMask;
+      uint32_t peidx = teidx >> nEdgePermBits;
+      uint32_t pcidx = moveTable->cornerPermuteTable(iPerm, tcidx);
+
+      rsplit(moveTable, pcidx, peidx, depth, currentDepth - 1, levels - 1,
+             roots);
+    }
+  }
+}
+
+// build the table from the specified position to the specified depth.
+// Each pass is split across threads at the positions a few twists
+// from the start, and each thread claims those positions one at a
+// time and recurses from them.
 void DepthTable::altbuild(const MoveTable *moveTable, std::size_t cidx,
                           std::size_t eidx, uint8_t depth) {
 
+  // thousands of subtrees (12^3 for QTM, 18^3 for FTM)
+  const uint8_t splitLevels = 3;
+
+  // only home is reached at first
+  std::size_t nReached = 1;
+  std::size_t nReachedLastPass = 1;
+
   // update the table to the specified depth
   for (uint8_t pass = 1; pass <= depth; ++pass) {
     consoleOut("starting pass " + to_commastring(pass, 2) + "... ");
-
-    std::size_t count = rbuild(moveTable, cidx, eidx, pass, pass);
+    auto start = std::chrono::steady_clock::now();
+
+    // the first few passes are too small to split
+    std::vector<ThreadLoad> loads;
+    std::size_t count = 0;
+    if (pass <= splitLevels) {
+      count = rbuild(moveTable, cidx, eidx, pass, pass);
+    } else {
+      std::vector<std::pair<uint32_t, uint32_t>> roots;
+      rsplit(moveTable, cidx, eidx, pass, pass, splitLevels, roots);
+
+      loads.resize(nBuildThreads);
+      std::atomic<std::size_t> nextRoot{0};
+      count = runThreads(
+          [&](std::size_t thread) {
+            std::size_t threadCount = 0;
+            for (std::size_t root = nextRoot++; root < roots.size();
+                 root = nextRoot++) {
+              threadCount += rbuild(moveTable, roots[root].first,
+                                    roots[root].second, pass,
+                                    pass - splitLevels);
+              ++loads[thread].nChunks;
+            }
+            return threadCount;
+          },
+          loads);
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
 
     consoleOut(to_commastring(count, 14) + " positions generated\n");
+    if (!loads.empty()) {
+      consoleOut("  " + loadBalance(loads) + "\n");
+    }
+
+    nReached += count;
+    BuildTelemetry::Pass record;
+    record.pass = pass;
+    record.kind = "recursive";
+    record.seconds = elapsed.count();
+    record.nReached = count;
+    record.nExpanded = nReachedLastPass;
+    record.nUnreached = nSymCoords - std::min(nSymCoords, nReached);
+    recordPass(record, loads);
+    nReachedLastPass = count;
+  }
+}
+
+// report a pass of the build to the console and telemetry
+void DepthTable::recordPass(BuildTelemetry::Pass &record,
+                            const std::vector<ThreadLoad> &loads) {
+  for (const auto &load : loads) {
+    record.threadSeconds.push_back(load.seconds);
+  }
+  consoleOut("  " + telemetry.record(record) + "\n");
+}
+
+// invoke visit with the index of each entry one twist away from the
+// specified entry, along with any entries equivalent to it
+template <class Visit>
+void DepthTable::forEachNeighbor(const MoveTable *moveTable, std::size_t cidx,
+                                 std::size_t eidx, Visit visit) const {
+
+  for (int iTwist = 0; iTwist < nTwistsPerMove; ++iTwist) {
+
+    // perform the twist on the corner and edge
+    uint32_t tcidx = moveTable->cornerTwistTable(iTwist, cidx);
+    uint32_t teidx = moveTable->edgeTwistTable(iTwist, eidx);
+
+    // since the edge twist may result in a permutation
+    // apply it to the corner
+    uint8_t iPerm = teidx & edgePermMask;
+    uint32_t peidx = teidx >> nEdgePermBits;
+    uint32_t pcidx = moveTable->cornerPermuteTable(iPerm, tcidx);
+
+    // obtain our index into the table
+    visit(fullIdx(pcidx, peidx));
+
+    // other positions with 2-, 4-, and 8-fold symmetry
+    uint16_t eposition = peidx >> 8;
+    for (const auto &p : moveTable->equivalentEdgePermutationTable[eposition]) {
+      uint32_t epeidx = moveTable->edgePermuteTable(p, peidx);
+      uint32_t epcidx = moveTable->cornerPermuteTable(p, pcidx);
+
+      visit(fullIdx(epcidx, epeidx));
+    }
+  }
+}
+
+// invoke visit with the corner and edge index of each entry within
+// the specified edge index range that the previous pass reached
+template <class Visit>
+void DepthTable::forEachReached(uint8_t pass, std::size_t start_eidx,
+                                std::size_t stop_eidx, Visit visit) const {
+
+  // only visit what the previous pass reached (if known)
+  if (frontier && frontier->isKnown()) {
+    const std::size_t begin = fullIdx(0, start_eidx);
+    const std::size_t end = fullIdx(0, stop_eidx);
+
+    for (std::size_t w = begin >> 6; w < (end + 63) >> 6; ++w) {
+      for (uint64_t bits = frontier->word(w); bits; bits &= bits - 1) {
+        std::size_t idx = (w << 6) + countTrailingZeros(bits);
+        if (idx >= begin && idx < end) {
+          visit(idx % nCornerCoords, idx / nCornerCoords);
+        }
+      }
+    }
+    return;
+  }
+
+  // otherwise search for positions that match the previous depth.
+  // since we build the table one depth at a time
+  // we need not perform a mutex read when finding
+  // the previous depth
+  const std::size_t end = fullIdx(0, stop_eidx);
+  const uint8_t depth = (pass - 1) % 3;
+  for (std::size_t idx = findDepth(data, fullIdx(0, start_eidx), end, depth);
+       idx < end; idx = findDepth(data, idx + 1, end, depth)) {
+    visit(idx % nCornerCoords, idx / nCornerCoords);
   }
 }
 
@@ -101,34 +306,10 @@ std::size_t DepthTable::buildWorker(const MoveTable *moveTable, uint8_t pass,
 
   std::size_t count = 0;
 
-  // search for positions that match the previous depth
-  // and expand those that do
-  for (std::size_t eidx = start_eidx; eidx < stop_eidx; ++eidx) {
-    for (std::size_t cidx = 0; cidx < nCornerCoords; ++cidx) {
-
-      // since we build the table one depth at a time
-      // we need not perform a mutex read when finding
-      // the previous depth
-      if (getDepth(cidx, eidx) == (pass - 1) % 3) {
-
-        // expand this position and mark any currently unreached
-        // positions with the current pass (depth)
-        for (int iTwist = 0; iTwist < nTwistsPerMove; ++iTwist) {
-
-          // perform the twist on the corner and edge
-          uint32_t tcidx = moveTable->cornerTwistTable(iTwist, cidx);
-          uint32_t teidx = moveTable->edgeTwistTable(iTwist, eidx);
-
-          // since the edge twist may result in a permutation
-          // apply it to the corner
-          uint8_t iPerm = teidx & edgePermMask;
-          uint32_t peidx = teidx >> nEdgePermBits;
-          uint32_t pcidx = moveTable->cornerPermuteTable(iPerm, tcidx);
-
-          // obtain our index into the table
-          std::size_t pidx = fullIdx(pcidx, peidx);
-
-          if (getDepth(pidx) == 0x3) {
+  forEachReached(
+      pass, start_eidx, stop_eidx, [&](std::size_t cidx, std::size_t eidx) {
+        forEachNeighbor(moveTable, cidx, eidx, [&](std::size_t idx) {
+          if (getDepth(idx) == 0x3) {
             // Since we do not read atomically, it is possible for one
             // thread to miss data written by another.  This will be
             // reflected in the (unpruned) count below from the actual
@@ -140,27 +321,12 @@ std::size_t DepthTable::buildWorker(const MoveTable *moveTable, uint8_t pass,
             // We still need to require memory_order_seq_cst on our
             // atomic write operation in case an _adjacent_ nibble is
             // set by another thread.
-            setDepthAtomically(pidx, pass % 3);
+            setDepthAtomically(idx, pass % 3);
+            markReached(idx);
           }
+        });
+      });
 
-          // mark other positions with 2-, 4-, and 8-fold symmetry
-          uint16_t eposition = peidx >> 8;
-          for (const auto &p :
-               moveTable->equivalentEdgePermutationTable[eposition]) {
-            uint32_t epeidx = moveTable->edgePermuteTable(p, peidx);
-            uint32_t epcidx = moveTable->cornerPermuteTable(p, pcidx);
-
-            std::size_t epidx = fullIdx(epcidx, epeidx);
-
-            if (getDepth(epidx) == 0x3) {
-              ++count;
-              setDepthAtomically(epidx, pass % 3);
-            }
-          }
-        }
-      }
-    }
-  }
   return count;
 }
 
@@ -173,81 +339,467 @@ std::size_t DepthTable::cleanupWorker(const MoveTable *moveTable, uint8_t pass,
 
   std::size_t count = 0;
 
-  // search for positions that match the previous depth
-  // and expand those that do
-  for (std::size_t eidx = start_eidx; eidx < stop_eidx; ++eidx) {
-    for (std::size_t cidx = 0; cidx < nCornerCoords; ++cidx) {
-
-      if (getDepth(cidx, eidx) == 0x3) {
+  // search for unreached positions and expand those we find
+  const std::size_t end = fullIdx(0, stop_eidx);
+  for (std::size_t idx = findDepth(data, fullIdx(0, start_eidx), end, 0x3);
+       idx < end; idx = findDepth(data, idx + 1, end, 0x3)) {
+    std::size_t cidx = idx % nCornerCoords;
+    std::size_t eidx = idx / nCornerCoords;
 
-        // expand this position and mark any currently unreached
-        // positions with the current pass (depth)
-        for (int iTwist = 0; iTwist < nTwistsPerMove; ++iTwist) {
+    // expand this position and mark any currently unreached
+    // positions with the current pass (depth)
+    for (int iTwist = 0; iTwist < nTwistsPerMove; ++iTwist) {
 
-          // perform the twist on the corner and edge
-          uint32_t tcidx = moveTable->cornerTwistTable(iTwist, cidx);
-          uint32_t teidx = moveTable->edgeTwistTable(iTwist, eidx);
+      // perform the twist on the corner and edge
+      uint32_t tcidx = moveTable->cornerTwistTable(iTwist, cidx);
+      uint32_t teidx = moveTable->edgeTwistTable(iTwist, eidx);
 
-          // since the edge twist may result in a permutation
-          // apply it to the corner
-          uint8_t iPerm = teidx & edgePermMask;
-          uint32_t peidx = teidx >> nEdgePermBits;
-          uint32_t pcidx = moveTable->cornerPermuteTable(iPerm, tcidx);
+      // since the edge twist may result in a permutation
+      // apply it to the corner
+      uint8_t iPerm = teidx & edgePermMask;
+      uint32_t peidx = teidx >> nEdgePermBits;
+      uint32_t pcidx = moveTable->cornerPermuteTable(iPerm, tcidx);
 
-          // obtain our index into the table
-          std::size_t pidx = fullIdx(pcidx, peidx);
+      // obtain our index into the table
+      std::size_t pidx = fullIdx(pcidx, peidx);
 
-          if (getDepth(pidx) == (pass - 1) % 3) {
+      if (getDepth(pidx) == (pass - 1) % 3) {
 
-            ++count;
+        ++count;
 
-            // since we partition each block into non-overlapping
-            // regions, we do not need to set atomically
-            setDepthNonAtomically(fullIdx(cidx, eidx), pass % 3);
+        // since we partition each block into non-overlapping
+        // regions, we do not need to set atomically
+        setDepthNonAtomically(idx, pass % 3);
 
-            // no need to twist anymore
-            break;
-          }
-        }
+        // no need to twist anymore
+        break;
       }
     }
   }
   return count;
 }
 
-void DepthTable::pbuild(std::size_t (DepthTable::*worker)(
-                            const MoveTable *moveTable, uint8_t pass,
-                            std::size_t start_eidx, std::size_t stop_eidx),
-                        uint8_t startdepth, uint8_t stopdepth, bool pruned,
-                        const MoveTable *moveTable) {
+// summarizes how evenly the work of a pass was spread over threads
+std::string DepthTable::loadBalance(const std::vector<ThreadLoad> &loads) {
+  auto byChunks = std::minmax_element(
+      loads.begin(), loads.end(), [](const ThreadLoad &a, const ThreadLoad &b) {
+        return a.nChunks < b.nChunks;
+      });
+  auto bySeconds = std::minmax_element(
+      loads.begin(), loads.end(), [](const ThreadLoad &a, const ThreadLoad &b) {
+        return a.seconds < b.seconds;
+      });
+
+  double total = 0;
+  for (const auto &load : loads) {
+    total += load.seconds;
+  }
+  double busiest = bySeconds.second->seconds;
+  auto balance = static_cast<int>(
+      busiest > 0 ? 100 * total / loads.size() / busiest + 0.5 : 100);
+
+  char seconds[64];
+  std::snprintf(seconds, sizeof(seconds), "%.2f-%.2f s",
+                bySeconds.first->seconds, busiest);
+
+  return std::to_string(loads.size()) + " threads: " +
+         std::to_string(byChunks.first->nChunks) + "-" +
+         std::to_string(byChunks.second->nChunks) + " chunks, " + seconds +
+         " busy (" + std::to_string(balance) + "% balanced)";
+}
 
-  for (uint8_t pass = startdepth; pass <= stopdepth; ++pass) {
-    consoleOut("starting pass " + to_commastring(pass, 2) + "... ");
+// run a task on each build thread, accumulating the time each spends
+std::size_t
+DepthTable::runThreads(const std::function<std::size_t(std::size_t)> &task,
+                       std::vector<ThreadLoad> &loads) const {
 
-    // nThreads may be any factor of nSymEdgeCoords
-    constexpr std::size_t nThreads = 16;
-    std::size_t nSymEdgeCoordsPerThread =
-        moveTable->getNSymEdgeCoords() / nThreads;
-
-    // split up the the table into equal-sized chunks and build
-    // at the specified depth
-    std::future<std::size_t> count[nThreads];
-    for (std::size_t thread = 0; thread < nThreads; ++thread) {
-      std::size_t start_eidx = thread * nSymEdgeCoordsPerThread;
-      std::size_t stop_eidx = start_eidx + nSymEdgeCoordsPerThread;
-      count[thread] =
-          std::async(worker, this, moveTable, pass, start_eidx, stop_eidx);
-    }
+  std::vector<std::future<std::size_t>> count(nBuildThreads);
+  for (std::size_t thread = 0; thread < nBuildThreads; ++thread) {
+    count[thread] = std::async(std::launch::async, [&, thread]() {
+      bindThread(thread);
+      auto start = std::chrono::steady_clock::now();
 
-    // collate
-    std::size_t totalCount = 0;
-    for (auto &thread : count) {
-      totalCount += thread.get();
+      std::size_t threadCount = task(thread);
+
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      loads[thread].seconds += elapsed.count();
+      return threadCount;
+    });
+  }
+
+  // collate
+  std::size_t totalCount = 0;
+  for (auto &thread : count) {
+    totalCount += thread.get();
+  }
+  return totalCount;
+}
+
+// run a pass of the worker over chunks of the table
+std::size_t DepthTable::chunkPass(
+    std::size_t (DepthTable::*worker)(const MoveTable *moveTable, uint8_t pass,
+                                      std::size_t start_eidx,
+                                      std::size_t stop_eidx),
+    const MoveTable *moveTable, uint8_t pass, std::vector<ThreadLoad> &loads) {
+
+  // the table is split into chunks of one edge position (256 edge
+  // coordinates) that threads claim until none remain.  Since the
+  // number of corner coordinates is even, each chunk starts on a byte
+  // boundary so that no byte is shared between chunks.
+  constexpr std::size_t chunkSize = 256;
+  const std::size_t nSymEdgeCoords = moveTable->getNSymEdgeCoords();
+  const std::size_t nChunks = (nSymEdgeCoords + chunkSize - 1) / chunkSize;
+
+  std::atomic<std::size_t> nextChunk{0};
+  return runThreads(
+      [&](std::size_t thread) {
+        std::size_t threadCount = 0;
+        for (std::size_t chunk = nextChunk++; chunk < nChunks;
+             chunk = nextChunk++) {
+          std::size_t start_eidx = chunk * chunkSize;
+          std::size_t stop_eidx =
+              std::min(start_eidx + chunkSize, nSymEdgeCoords);
+          threadCount +=
+              (this->*worker)(moveTable, pass, start_eidx, stop_eidx);
+          ++loads[thread].nChunks;
+        }
+        return threadCount;
+      },
+      loads);
+}
+
+// run an expanding pass in rounds.  In each round, every thread
+// gathers the neighbors of the positions reached by the previous pass
+// from the edge coordinates it claims, until its share of the buffer
+// is full, and sorts them by region of the table.  Then each thread
+// claims whole regions and marks the unreached neighbors within them.
+std::size_t DepthTable::scatterPass(const MoveTable *moveTable, uint8_t pass,
+                                    std::vector<ThreadLoad> &loads) {
+
+  // a region spans 1 MB of the table.  regions start on a byte (and
+  // frontier word) boundary, so each has a single writer.
+  constexpr unsigned regionBits = 22;
+  constexpr std::size_t regionMask = (std::size_t(1) << regionBits) - 1;
+  const std::size_t nRegions = (nSymCoords + regionMask) >> regionBits;
+
+  // neighbors buffered by all threads in a round
+  constexpr std::size_t bufferSize = std::size_t(1) << 26;
+  const std::size_t threadBufferSize = bufferSize / nBuildThreads;
+
+  const std::size_t nSymEdgeCoords = moveTable->getNSymEdgeCoords();
+
+  // neighbors gathered by each thread, then sorted by region.
+  // region r of thread t spans [starts[t][r], starts[t][r + 1]).
+  std::vector<std::vector<uint64_t>> gathered(nBuildThreads);
+  std::vector<std::vector<uint32_t>> sorted(nBuildThreads);
+  std::vector<std::vector<std::size_t>> starts(nBuildThreads);
+
+  std::atomic<std::size_t> nextEidx{0};
+  std::size_t count = 0;
+
+  while (nextEidx < nSymEdgeCoords) {
+
+    runThreads(
+        [&](std::size_t thread) {
+          auto &neighbors = gathered[thread];
+          neighbors.clear();
+          for (std::size_t eidx = nextEidx++; eidx < nSymEdgeCoords;
+               eidx = nextEidx++) {
+            forEachReached(pass, eidx, eidx + 1, [&](std::size_t cidx,
+                                                     std::size_t) {
+              forEachNeighbor(moveTable, cidx, eidx, [&](std::size_t idx) {
+                neighbors.push_back(idx);
+              });
+            });
+            ++loads[thread].nChunks;
+            if (neighbors.size() >= threadBufferSize) {
+              break;
+            }
+          }
+
+          // counting sort by region
+          auto &start = starts[thread];
+          start.assign(nRegions + 1, 0);
+          for (auto idx : neighbors) {
+            ++start[(idx >> regionBits) + 1];
+          }
+          std::partial_sum(start.begin(), start.end(), start.begin());
+
+          std::vector<std::size_t> next(start.begin(), start.end() - 1);
+          sorted[thread].resize(neighbors.size());
+          for (auto idx : neighbors) {
+            sorted[thread][next[idx >> regionBits]++] =
+                static_cast<uint32_t>(idx & regionMask);
+          }
+          return std::size_t(0);
+        },
+        loads);
+
+    std::atomic<std::size_t> nextRegion{0};
+    count += runThreads(
+        [&](std::size_t) {
+          std::size_t threadCount = 0;
+          for (std::size_t region = nextRegion++; region < nRegions;
+               region = nextRegion++) {
+            std::size_t base = region << regionBits;
+            for (std::size_t t = 0; t < nBuildThreads; ++t) {
+              for (std::size_t i = starts[t][region];
+                   i < starts[t][region + 1]; ++i) {
+                std::size_t idx = base + sorted[t][i];
+
+                // this thread alone writes to the region
+                if (getDepth(idx) == 0x3) {
+                  ++threadCount;
+                  setDepthNonAtomically(idx, pass % 3);
+                  markReached(idx);
+                }
+              }
+            }
+          }
+          return threadCount;
+        },
+        loads);
+  }
+
+  return count;
+}
+
+// run an expanding pass where each region of the table has a single
+// owning thread.  Regions are dealt round-robin to the threads.  Each
+// thread expands the positions reached by the previous pass within
+// its own regions, marking neighbors that fall in its own regions
+// directly and sending the rest in batches to their owners' inboxes.
+// Threads drain their inboxes between edge coordinates and once all
+// threads have sent everything.
+std::size_t DepthTable::ownerPass(const MoveTable *moveTable, uint8_t pass,
+                                  std::vector<ThreadLoad> &loads) {
+
+  // regions of 256 edge coordinates start on a byte (and frontier
+  // word) boundary
+  constexpr std::size_t regionEdgeCoords = 256;
+  const std::size_t regionSize = regionEdgeCoords * nCornerCoords;
+  const std::size_t nSymEdgeCoords = moveTable->getNSymEdgeCoords();
+  const std::size_t nRegions =
+      (nSymEdgeCoords + regionEdgeCoords - 1) / regionEdgeCoords;
+
+  // neighbors sent to another thread at a time
+  constexpr std::size_t batchSize = 1024;
+
+  struct Inbox {
+    std::mutex mutex;
+    std::vector<std::vector<uint64_t>> batches;
+  };
+  std::vector<Inbox> inboxes(nBuildThreads);
+  std::atomic<std::size_t> nFinished{0};
+
+  return runThreads(
+      [&](std::size_t thread) {
+        std::size_t threadCount = 0;
+
+        // only this thread writes to its regions
+        auto mark = [&](std::size_t idx) {
+          if (getDepth(idx) == 0x3) {
+            ++threadCount;
+            setDepthNonAtomically(idx, pass % 3);
+            markReached(idx);
+          }
+        };
+
+        // mark whatever other threads have sent so far
+        auto drain = [&]() {
+          std::vector<std::vector<uint64_t>> batches;
+          {
+            std::lock_guard<std::mutex> lock(inboxes[thread].mutex);
+            batches.swap(inboxes[thread].batches);
+          }
+          for (const auto &batch : batches) {
+            for (auto idx : batch) {
+              mark(idx);
+            }
+          }
+          return !batches.empty();
+        };
+
+        std::vector<std::vector<uint64_t>> outboxes(nBuildThreads);
+        auto send = [&](std::size_t owner) {
+          std::vector<uint64_t> batch;
+          batch.swap(outboxes[owner]);
+          std::lock_guard<std::mutex> lock(inboxes[owner].mutex);
+          inboxes[owner].batches.push_back(std::move(batch));
+        };
+
+        for (std::size_t region = thread; region < nRegions;
+             region += nBuildThreads) {
+          std::size_t start_eidx = region * regionEdgeCoords;
+          std::size_t stop_eidx =
+              std::min(start_eidx + regionEdgeCoords, nSymEdgeCoords);
+          for (std::size_t eidx = start_eidx; eidx < stop_eidx; ++eidx) {
+            forEachReached(pass, eidx, eidx + 1, [&](std::size_t cidx,
+                                                     std::size_t) {
+              forEachNeighbor(moveTable, cidx, eidx, [&](std::size_t idx) {
+                std::size_t owner = idx / regionSize % nBuildThreads;
+                if (owner == thread) {
+                  mark(idx);
+                } else {
+                  outboxes[owner].push_back(idx);
+                  if (outboxes[owner].size() >= batchSize) {
+                    send(owner);
+                  }
+                }
+              });
+            });
+            drain();
+          }
+          ++loads[thread].nChunks;
+        }
+
+        for (std::size_t owner = 0; owner < nBuildThreads; ++owner) {
+          if (!outboxes[owner].empty()) {
+            send(owner);
+          }
+        }
+
+        // nothing more is sent once every thread has finished
+        ++nFinished;
+        while (nFinished < nBuildThreads) {
+          if (!drain()) {
+            std::this_thread::yield();
+          }
+        }
+        drain();
+
+        return threadCount;
+      },
+      loads);
+}
+
+std::size_t DepthTable::buildPass(std::size_t (DepthTable::*worker)(
+                                      const MoveTable *moveTable, uint8_t pass,
+                                      std::size_t start_eidx,
+                                      std::size_t stop_eidx),
+                                  uint8_t pass, bool pruned,
+                                  const MoveTable *moveTable,
+                                  std::size_t nExpanding,
+                                  std::size_t nUnreached) {
+
+  // only expanding passes may be scattered or owned
+  bool expanding = worker == &DepthTable::buildWorker;
+  bool scattering = expanding && buildMode == BuildMode::scatter;
+  bool owning = expanding && buildMode == BuildMode::owner;
+
+  // expanding passes scan the frontier (if known), searching passes
+  // the table
+  BuildTelemetry::Pass record;
+  record.pass = pass;
+  record.kind = !expanding   ? "searching"
+                : scattering ? "scattering"
+                : owning     ? "owning"
+                             : "expanding";
+  record.nExpanded = nExpanding;
+  record.scanBytes = expanding && frontier && frontier->isKnown()
+                         ? nSymCoords / 8
+                         : nSymCoords / 4;
+
+  consoleOut("starting pass " + to_commastring(pass, 2) + "... ");
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<ThreadLoad> loads(nBuildThreads);
+  std::size_t totalCount =
+      scattering ? scatterPass(moveTable, pass, loads)
+      : owning   ? ownerPass(moveTable, pass, loads)
+                 : chunkPass(worker, moveTable, pass, loads);
+
+  // scattered and owned counts are exact
+  consoleOut(to_commastring(totalCount, 14) + " positions generated" +
+             (pruned || scattering || owning ? "\n" : " (unpruned)\n"));
+  consoleOut("  " + loadBalance(loads) + "\n");
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  record.seconds = elapsed.count();
+  record.nReached = totalCount;
+  record.nUnreached = nUnreached - std::min(nUnreached, totalCount);
+  recordPass(record, loads);
+
+  if (frontier) {
+    frontier->advance();
+  }
+
+  saveCheckpoint(pass);
+
+  return totalCount;
+}
+
+// An expanding pass looks up every twist of each position the
+// previous pass reached, while a searching pass looks up the twists
+// of each unreached position until one leads to the previous pass;
+// about half of them on average.  Search once that is cheaper.
+bool DepthTable::searchIsCheaper(std::size_t nReachedLastPass,
+                                 std::size_t nUnreached) {
+  return nUnreached < 2 * nReachedLastPass;
+}
+
+// track the positions reached by each pass if there's room
+void DepthTable::trackFrontier() {
+  std::size_t needed = Frontier::memoryNeeded(nSymCoords);
+  if (NumaNodes::availableMemory() >= needed) {
+    try {
+      frontier = std::make_unique<Frontier>(nSymCoords);
+      return;
+    } catch (const std::bad_alloc &) {
+      // fall back to scanning
     }
+  }
+
+  consoleOut("insufficient memory to track the frontier; scanning the "
+             "whole table each pass\n");
+}
+
+// save the table built so far
+void DepthTable::saveCheckpoint(uint8_t pass) {
 
-    consoleOut(to_commastring(totalCount, 14) + " positions generated" +
-               (pruned ? "\n" : " (unpruned)\n"));
+  // the finished table is saved anyway
+  if (pass >= finalDepth) {
+    return;
   }
+
+  // the header marks the file as unfinished until the table is
+  if (storage->isFileBacked()) {
+    DepthTableHeader unfinished(header);
+    unfinished.setPass(pass);
+    std::vector<uint8_t> page(DepthTableHeader::size);
+    unfinished.write(page.data());
+    storage->flush(page.data());
+  }
+
+  if (!checkpointing) {
+    return;
+  }
+
+  consoleOut("saving checkpoint... ");
+  if (checkpoint.save(data, header, pass)) {
+    consoleOut("done\n");
+  } else {
+    consoleOut("couldn't write " + checkpoint.getPath() + "\n");
+  }
+}
+
+bool DepthTable::buildInFile() {
+  auto file = std::make_unique<FileStorage>(tableFilename, nSymCoords / 4);
+  if (!file->data()) {
+    consoleOut("unable to map " + tableFilename +
+               " for writing; building in memory instead\n");
+    return false;
+  }
+
+  // the memory the table was to be loaded into is released.  (NUMA
+  // interleaving doesn't apply to the file cache, so isn't repeated.)
+  consoleOut("building depth table in " + tableFilename + "\n");
+  storage = std::move(file);
+  adata = storage->atomicData();
+  data = storage->data();
+  return true;
 }
 
 // main entry point for depth table building
@@ -255,30 +807,553 @@ void DepthTable::pbuild(std::size_t (DepthTable::*worker)(
 // thread, then in parallel one pass (depth) at a time
 void DepthTable::build(const MoveTable *moveTable) {
 
-  consoleOut("clearing table...\n");
-  clear();
+  // resume from the last pass checkpointed (if any)
+  uint8_t lastPass = checkpointing ? checkpoint.load(data, header) : 0;
 
-  consoleOut("start table build!\n");
+  if (lastPass) {
+    consoleOut("resuming table build after pass " + std::to_string(lastPass) +
+               " from " + checkpoint.getPath() + "\n");
+  } else {
+    consoleOut("clearing table...\n");
+    clear();
 
-  // mark the "home" Janus position with a depth of zero
-  std::size_t cidx = moveTable->getHomeCornerIndex();
-  std::size_t eidx = moveTable->getHomeEdgeIndex();
-  std::size_t idx = fullIdx(cidx, eidx);
-  setDepthNonAtomically(idx, 0);
+    consoleOut("start table build!\n");
+
+    // mark the "home" Janus position with a depth of zero
+    std::size_t cidx = moveTable->getHomeCornerIndex();
+    std::size_t eidx = moveTable->getHomeEdgeIndex();
+    std::size_t idx = fullIdx(cidx, eidx);
+    setDepthNonAtomically(idx, 0);
+
+    altbuild(moveTable, cidx, eidx, altDepth);
+    saveCheckpoint(altDepth);
+    lastPass = altDepth;
+  }
 
-  // do seven passes recursively (but single-threaded)
-  // this number can be tuned for faster build
-  const uint8_t altDepth = 7;
-  altbuild(moveTable, cidx, eidx, altDepth);
+  // the counts of the table so far decide how to build each pass.
+  // the positions at the last pass's depth (mod 3) stand in for
+  // those it reached.
+  consoleOut("counting positions...\n");
+  Checks checks = scan();
+  std::size_t nUnreached = checks.count[3];
+  std::size_t nReachedLastPass = checks.count[lastPass % 3];
+
+  consoleOut(std::string("scanning with the ") + depthScanKernel() +
+             " kernel\n");
 
   // do passes in parallel looking for existing
   // moves and seeing if they lead to unreached moves
-  pbuild(&DepthTable::buildWorker, altDepth + 1, buildDepth, false, moveTable);
+  // until it's cheaper to look for unreached moves
+  // and see if they lead to existing moves
+  bool searching = false;
+  trackFrontier();
+  for (uint8_t pass = lastPass + 1; pass <= finalDepth; ++pass) {
+    if (!searching && searchIsCheaper(nReachedLastPass, nUnreached)) {
+      consoleOut("searching unreached positions from pass " +
+                 std::to_string(pass) + "\n");
+      searching = true;
+      frontier.reset();
+    }
+
+    // a searching pass searches from each unreached position
+    nReachedLastPass =
+        searching ? buildPass(&DepthTable::cleanupWorker, pass, true, moveTable,
+                              nUnreached, nUnreached)
+                  : buildPass(&DepthTable::buildWorker, pass, false, moveTable,
+                              nReachedLastPass, nUnreached);
+    nUnreached -= std::min(nUnreached, nReachedLastPass);
+  }
+  frontier.reset();
+}
+
+// rewrite the header page of a table file in place
+static bool writeHeaderPage(const std::string &path, const uint8_t *page) {
+  std::FILE *file = std::fopen(path.c_str(), "r+b");
+  if (!file) {
+    return false;
+  }
+  bool written =
+      std::fwrite(page, 1, DepthTableHeader::size, file) ==
+      DepthTableHeader::size;
+  return std::fclose(file) == 0 && written;
+}
+
+// build the table one shard at a time, directly in the table file.
+//
+// Each pass expands the positions the previous pass reached, one
+// shard at a time.  Neighbors within the shard are marked at once;
+// the others are sorted and appended to a spill file for their own
+// shard.  Then each shard with a spill file is read back in and
+// marked from it.  The positions reached by each pass are tracked
+// (a bit per position) in two files that swap roles every pass, and
+// shards that the previous pass didn't reach are skipped.
+bool DepthTable::buildInShards(const MoveTable *moveTable) {
+  const std::size_t nBytes = nSymCoords / 4;
+  const std::size_t nShards = (nBytes + shardBytes - 1) / shardBytes;
+  const std::size_t shardEntries = 4 * shardBytes;
+
+  // neighbors a thread buffers for each other shard before spilling
+  constexpr std::size_t spillBatch = static_cast<std::size_t>(1) << 14;
+
+  // positions whose reached bits a thread claims at a time
+  constexpr std::size_t wordsPerClaim = 4096;
+
+  consoleOut("building depth table in " + std::to_string(nShards) +
+             " shards of " + to_commastring(shardBytes >> 20, 0) + " MB\n");
+
+  auto ignoreProgress = [](std::size_t) {};
+  utils::StripedFile tableFile({tableFilename});
+  utils::StripedFile reachedFiles[2] = {
+      utils::StripedFile({tableFilename + ".reached.0"}),
+      utils::StripedFile({tableFilename + ".reached.1"})};
+  utils::StripedFile *previousFile = &reachedFiles[0];
+  utils::StripedFile *currentFile = &reachedFiles[1];
+
+  // the shard in memory, with the positions reached by the
+  // previous and current passes
+  std::vector<uint8_t> shard(std::min(shardBytes, nBytes));
+  std::vector<uint64_t> previous(shard.size() / 16);
+  std::vector<uint64_t> current(shard.size() / 16);
+  auto *atomicShard = reinterpret_cast<std::atomic_uint8_t *>(shard.data());
+  auto *atomicCurrent =
+      reinterpret_cast<std::atomic<uint64_t> *>(current.data());
+
+  auto shardSize = [&](std::size_t s) {
+    return std::min(shardBytes, nBytes - s * shardBytes);
+  };
+
+  auto failed = [&](const utils::StripedFile &file) {
+    consoleOut("couldn't access " + file.failedPath() + "\n");
+    return false;
+  };
+
+  // bytes read from and written to disk during a pass
+  std::atomic<std::size_t> diskBytes{0};
+
+  // transfer a shard (or its reached bits) to or from its file
+  auto readShard = [&](std::size_t s) {
+    diskBytes += shardSize(s);
+    return tableFile.read(shard.data(), shardSize(s),
+                          DepthTableHeader::size + s * shardBytes,
+                          ignoreProgress) == shardSize(s);
+  };
+  auto writeShard = [&](std::size_t s) {
+    diskBytes += shardSize(s);
+    return tableFile.write(shard.data(), shardSize(s),
+                           DepthTableHeader::size + s * shardBytes,
+                           ignoreProgress) == shardSize(s);
+  };
+  auto readBits = [&](const utils::StripedFile *file,
+                      std::vector<uint64_t> &bits, std::size_t s) {
+    std::size_t n = shardSize(s) / 2;
+    diskBytes += n;
+    return file->read(reinterpret_cast<uint8_t *>(bits.data()), n,
+                      DepthTableHeader::size + s * (shardBytes / 2),
+                      ignoreProgress) == n;
+  };
+  auto writeBits = [&](const utils::StripedFile *file,
+                       std::vector<uint64_t> &bits, std::size_t s) {
+    std::size_t n = shardSize(s) / 2;
+    diskBytes += n;
+    return file->write(reinterpret_cast<uint8_t *>(bits.data()), n,
+                       DepthTableHeader::size + s * (shardBytes / 2),
+                       ignoreProgress) == n;
+  };
+
+  // mark an unreached position of the shard in memory
+  auto claim = [&](std::size_t local, uint8_t pass) {
+    unsigned shift = (local & 3) << 1;
+    uint8_t mask = ~((~(pass % 3) & 0x03) << shift);
+    if (((atomicShard[local >> 2].fetch_and(mask) >> shift) & 0x3) != 0x3) {
+      return false;
+    }
+    atomicCurrent[local >> 6].fetch_or(uint64_t(1) << (local & 63),
+                                       std::memory_order_relaxed);
+    return true;
+  };
+
+  // neighbors sent to each shard during a pass
+  struct Spill {
+    std::unique_ptr<utils::StripedFile> file;
+    std::size_t nBytes = 0;
+    std::mutex mutex;
+  };
+  std::vector<Spill> spills(nShards);
+
+  // start with a zeroed header page (which isn't mistaken for a
+  // table) and an unreached table, but for home.  The reached files
+  // get a (blank) page too, since only a write at the start of a file
+  // replaces it.
+  const std::size_t home = fullIdx(moveTable->getHomeCornerIndex(),
+                                   moveTable->getHomeEdgeIndex());
+  std::vector<uint8_t> page(DepthTableHeader::size);
+  for (const auto *file : {&tableFile, previousFile, currentFile}) {
+    if (file->write(page.data(), page.size(), 0, ignoreProgress) !=
+        page.size()) {
+      return failed(*file);
+    }
+  }
+  std::vector<bool> reachedPrevious(nShards), reachedCurrent(nShards);
+  for (std::size_t s = 0; s < nShards; ++s) {
+    std::fill(shard.begin(), shard.end(), 0xff);
+    if (home / shardEntries == s) {
+      std::size_t local = home % shardEntries;
+      shard[local >> 2] &= ~(0x3 << ((local & 3) << 1));
+      std::fill(previous.begin(), previous.end(), 0);
+      previous[local >> 6] |= uint64_t(1) << (local & 63);
+      if (!writeBits(previousFile, previous, s)) {
+        return failed(*previousFile);
+      }
+      reachedPrevious[s] = true;
+    }
+    if (!writeShard(s)) {
+      return failed(tableFile);
+    }
+  }
+
+  // only home is reached at first
+  std::size_t nReached = 1;
+  std::size_t nReachedLastPass = 1;
+
+  for (uint8_t pass = 1; pass <= finalDepth; ++pass) {
+    consoleOut("starting pass " + to_commastring(pass, 2) + "... ");
+    auto passStart = std::chrono::steady_clock::now();
+    diskBytes = 0;
+
+    std::vector<ThreadLoad> loads(nBuildThreads);
+    std::size_t totalCount = 0;
+    std::size_t nSpilled = 0;
+    std::vector<bool> expanded(nShards);
+    std::fill(reachedCurrent.begin(), reachedCurrent.end(), false);
+    for (std::size_t t = 0; t < nShards; ++t) {
+      spills[t].file = std::make_unique<utils::StripedFile>(
+          std::vector<std::string>{tableFilename + ".spill." +
+                                   std::to_string(t + 1)});
+      spills[t].nBytes = 0;
+    }
+
+    // expand the positions reached by the previous pass
+    for (std::size_t s = 0; s < nShards; ++s) {
+      if (!reachedPrevious[s]) {
+        continue;
+      }
+      if (!readShard(s)) {
+        return failed(tableFile);
+      }
+      if (!readBits(previousFile, previous, s)) {
+        return failed(*previousFile);
+      }
+      std::fill(current.begin(), current.end(), 0);
+
+      const std::size_t base = s * shardEntries;
+      const std::size_t nWords = shardSize(s) / 16;
+      std::atomic<std::size_t> nextWord{0};
+      std::atomic<bool> spillFailed{false};
+      std::size_t count = runThreads(
+          [&](std::size_t thread) {
+            std::size_t threadCount = 0;
+            std::vector<std::vector<uint64_t>> batches(nShards);
+
+            auto spill = [&](std::size_t t) {
+              auto &batch = batches[t];
+              std::sort(batch.begin(), batch.end());
+              std::size_t n = batch.size() * sizeof(uint64_t);
+              diskBytes += n;
+              std::lock_guard<std::mutex> lock(spills[t].mutex);
+              if (spills[t].file->write(
+                      reinterpret_cast<const uint8_t *>(batch.data()), n,
+                      spills[t].nBytes, ignoreProgress) != n) {
+                spillFailed = true;
+              }
+              spills[t].nBytes += n;
+              batch.clear();
+            };
+
+            for (std::size_t begin = nextWord.fetch_add(wordsPerClaim);
+                 begin < nWords; begin = nextWord.fetch_add(wordsPerClaim)) {
+              std::size_t end = std::min(begin + wordsPerClaim, nWords);
+              for (std::size_t w = begin; w < end; ++w) {
+                for (uint64_t bits = previous[w]; bits; bits &= bits - 1) {
+                  std::size_t idx = base + (w << 6) + countTrailingZeros(bits);
+                  forEachNeighbor(
+                      moveTable, idx % nCornerCoords, idx / nCornerCoords,
+                      [&](std::size_t neighbor) {
+                        std::size_t t = neighbor / shardEntries;
+                        if (t == s) {
+                          threadCount += claim(neighbor - base, pass);
+                        } else {
+                          batches[t].push_back(neighbor);
+                          if (batches[t].size() == spillBatch) {
+                            spill(t);
+                          }
+                        }
+                      });
+                }
+              }
+              ++loads[thread].nChunks;
+            }
+
+            for (std::size_t t = 0; t < nShards; ++t) {
+              if (!batches[t].empty()) {
+                spill(t);
+              }
+            }
+            return threadCount;
+          },
+          loads);
+
+      if (spillFailed) {
+        consoleOut("couldn't write spill files\n");
+        return false;
+      }
+      if (!writeShard(s)) {
+        return failed(tableFile);
+      }
+      if (!writeBits(currentFile, current, s)) {
+        return failed(*currentFile);
+      }
+      expanded[s] = true;
+      reachedCurrent[s] = count != 0;
+      totalCount += count;
+    }
+
+    // mark the neighbors spilled to each shard
+    for (std::size_t t = 0; t < nShards; ++t) {
+      std::size_t nSpill = spills[t].nBytes / sizeof(uint64_t);
+      if (!nSpill) {
+        continue;
+      }
+      nSpilled += nSpill;
+      if (!readShard(t)) {
+        return failed(tableFile);
+      }
+      if (expanded[t]) {
+        if (!readBits(currentFile, current, t)) {
+          return failed(*currentFile);
+        }
+      } else {
+        std::fill(current.begin(), current.end(), 0);
+      }
+
+      const std::size_t base = t * shardEntries;
+      std::atomic<std::size_t> nextBatch{0};
+      std::atomic<bool> readFailed{false};
+      std::size_t count = runThreads(
+          [&](std::size_t thread) {
+            std::size_t threadCount = 0;
+            std::vector<uint64_t> batch(spillBatch);
+            for (std::size_t begin = nextBatch.fetch_add(spillBatch);
+                 begin < nSpill; begin = nextBatch.fetch_add(spillBatch)) {
+              std::size_t n = std::min(spillBatch, nSpill - begin);
+              diskBytes += n * sizeof(uint64_t);
+              if (spills[t].file->read(
+                      reinterpret_cast<uint8_t *>(batch.data()),
+                      n * sizeof(uint64_t), begin * sizeof(uint64_t),
+                      ignoreProgress) != n * sizeof(uint64_t)) {
+                readFailed = true;
+                break;
+              }
+              for (std::size_t i = 0; i < n; ++i) {
+                threadCount += claim(batch[i] - base, pass);
+              }
+              ++loads[thread].nChunks;
+            }
+            return threadCount;
+          },
+          loads);
+
+      if (readFailed) {
+        return failed(*spills[t].file);
+      }
+      if (!writeShard(t)) {
+        return failed(tableFile);
+      }
+      if (!writeBits(currentFile, current, t)) {
+        return failed(*currentFile);
+      }
+      spills[t].file->remove();
+      reachedCurrent[t] = reachedCurrent[t] || count != 0;
+      totalCount += count;
+    }
+
+    consoleOut(to_commastring(totalCount, 14) + " positions generated\n");
+    consoleOut("  " + to_commastring(nSpilled, 0) +
+               " neighbors spilled; " + loadBalance(loads) + "\n");
+
+    // the reached bits of each expanded shard are scanned
+    std::chrono::duration<double> passElapsed =
+        std::chrono::steady_clock::now() - passStart;
+    nReached += totalCount;
+    BuildTelemetry::Pass record;
+    record.pass = pass;
+    record.kind = "out-of-core";
+    record.seconds = passElapsed.count();
+    record.nReached = totalCount;
+    record.nExpanded = nReachedLastPass;
+    record.scanBytes = std::count(expanded.begin(), expanded.end(), true) *
+                       (shardBytes / 2);
+    record.diskBytes = diskBytes;
+    record.nUnreached = nSymCoords - std::min(nSymCoords, nReached);
+    recordPass(record, loads);
+    nReachedLastPass = totalCount;
+
+    // the header marks the file as unfinished until the table is
+    DepthTableHeader unfinished(header);
+    unfinished.setPass(pass);
+    unfinished.write(page.data());
+    writeHeaderPage(tableFilename, page.data());
+
+    std::swap(previousFile, currentFile);
+    std::swap(reachedPrevious, reachedCurrent);
+  }
+  reachedFiles[0].remove();
+  reachedFiles[1].remove();
+
+  // sign and validate the finished table one shard at a time
+  consoleOut("Validating...\n");
+  auto start = std::chrono::steady_clock::now();
+  Checks checks;
+  for (std::size_t s = 0; s < nShards; ++s) {
+    if (!readShard(s)) {
+      return failed(tableFile);
+    }
+    header.signBlocks(shard.data(), s * shardBytes, shardSize(s));
+    checks.append(scan(shard.data(), shardSize(s)));
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  if (!checkTable(checks, elapsed.count())) {
+    consoleOut("CHECKSUM FAILED!\n");
+    consoleOut("RESULTS NOT GUARANTEED.\n");
+  }
+
+  header.write(page.data());
+  if (!writeHeaderPage(tableFilename, page.data())) {
+    consoleOut("couldn't write " + tableFilename + "\n");
+    return false;
+  }
+  return true;
+}
+
+// use the table file built out of core
+bool DepthTable::mapTableFile() {
+  auto mapped = std::make_unique<MappedStorage>(
+      tableFilename, header, MappedStorage::Mode::lazy, consoleOut);
+  if (!mapped->isPopulated()) {
+    return false;
+  }
 
-  // do three passes in parallel looking for unreached
-  // moves and seeing if they lead to existing moves
-  pbuild(&DepthTable::cleanupWorker, buildDepth + 1, finalDepth, true,
-         moveTable);
+  storage = std::move(mapped);
+  adata = storage->atomicData();
+  data = storage->data();
+  return true;
+}
+
+// checks folded over the four entries of every possible byte
+// (lowest bits first)
+static const struct ByteChecks {
+  ByteChecks() {
+    for (unsigned byte = 0; byte < 256; ++byte) {
+      sum[byte] = 0;
+      product[byte] = 1;
+      for (unsigned entry = 0; entry < 4; ++entry) {
+        uint32_t depth = (byte >> (entry << 1)) & 0x3;
+        product[byte] *= (depth << 1) | 1;
+        sum[byte] += product[byte];
+      }
+    }
+  }
+
+  uint32_t sum[256];
+  uint32_t product[256];
+} byteChecks;
+
+// scan the bytes in [begin, end) of the table
+DepthTable::Checks DepthTable::scanBytes(const uint8_t *table,
+                                         std::size_t begin, std::size_t end) {
+
+  // split the range into four lanes of whole words that are scanned
+  // together so that their multiplications overlap
+  constexpr std::size_t nLanes = 4;
+  const std::size_t laneSize = (end - begin) / (nLanes * 8) * 8;
+  const uint64_t lowBits = 0x5555555555555555ULL;
+
+  Checks lanes[nLanes];
+  for (std::size_t offset = 0; offset < laneSize; offset += 8) {
+    for (std::size_t lane = 0; lane < nLanes; ++lane) {
+      Checks &checks = lanes[lane];
+      const uint8_t *bytes = table + begin + lane * laneSize + offset;
+
+      // count the depths of all 32 entries of the word at once
+      uint64_t word;
+      std::memcpy(&word, bytes, sizeof(word));
+      uint64_t lo = word & lowBits;
+      uint64_t hi = (word >> 1) & lowBits;
+      unsigned nThrees = popcount(lo & hi);
+      checks.count[1] += popcount(lo) - nThrees;
+      checks.count[2] += popcount(hi) - nThrees;
+      checks.count[3] += nThrees;
+
+      for (std::size_t i = 0; i < sizeof(word); ++i) {
+        checks.sum += checks.product * byteChecks.sum[bytes[i]];
+        checks.product *= byteChecks.product[bytes[i]];
+      }
+    }
+  }
+
+  Checks checks;
+  for (auto &lane : lanes) {
+    lane.count[0] = 4 * laneSize - lane.count[1] - lane.count[2] -
+                    lane.count[3];
+    checks.append(lane);
+  }
+
+  // scan any leftover bytes one entry at a time
+  for (std::size_t loc = begin + nLanes * laneSize; loc < end; ++loc) {
+    for (std::size_t idx = loc << 2; idx < (loc + 1) << 2; ++idx) {
+      uint32_t depth = (table[loc] >> ((idx & 3) << 1)) & 0x3;
+      ++checks.count[depth];
+      checks.product *= (depth << 1) | 1;
+      checks.sum += checks.product;
+    }
+  }
+
+  return checks;
+}
+
+// scan the table in parallel, one block at a time
+DepthTable::Checks DepthTable::scan(const uint8_t *table,
+                                    std::size_t nBytes) const {
+  const std::size_t blockSize = static_cast<std::size_t>(1) << 20;
+  const std::size_t nBlocks = (nBytes + blockSize - 1) / blockSize;
+
+  std::vector<Checks> blocks(nBlocks);
+  std::atomic<std::size_t> nextBlock{0};
+
+  std::size_t nThreads = std::max(1U, std::thread::hardware_concurrency());
+  std::vector<std::future<void>> workers(std::min(nThreads, nBlocks));
+  for (std::size_t thread = 0; thread < workers.size(); ++thread) {
+    workers[thread] = std::async(std::launch::async, [&, thread]() {
+      bindThread(thread);
+      for (std::size_t block = nextBlock++; block < nBlocks;
+           block = nextBlock++) {
+        std::size_t begin = block * blockSize;
+        blocks[block] =
+            scanBytes(table, begin, std::min(begin + blockSize, nBytes));
+      }
+    });
+  }
+
+  for (auto &worker : workers) {
+    worker.get();
+  }
+
+  // combine the blocks in table order
+  Checks checks;
+  for (const auto &block : blocks) {
+    checks.append(block);
+  }
+  return checks;
 }
 
 // generates checksum and checkproduct used in validate()
@@ -286,25 +1361,14 @@ void DepthTable::build(const MoveTable *moveTable) {
 // in the event there are mistakes in the table...
 void DepthTable::certify() const {
 
-  // make a table with multipicative reciprocal
-  // of depth values constrained to be odd
-  std::vector<std::size_t> reciprocal(16);
-  for (int depth = 0; depth < 16; ++depth) {
-    reciprocal[depth] = divide(1, (depth << 1) | 1);
-  }
-
-  // initialize checks with the two-faced Janus magic number
-  std::uint32_t checkSum = janusMagicNumber;
-  std::uint32_t checkProduct = janusMagicNumber;
-
   consoleOut("generating initial depth checks...\n");
 
-  // run validate() in reverse via modular arithmetic
-  for (std::size_t idx = 0; idx < nSymCoords; ++idx) {
-    uint32_t depth = getDepth(nSymCoords - 1 - idx);
-    checkSum -= checkProduct;
-    checkProduct *= reciprocal[depth];
-  }
+  Checks checks = scan();
+
+  // solve for the initial checks that yield the two-faced Janus
+  // magic number via modular arithmetic (the product is odd)
+  std::uint32_t checkProduct = divide(janusMagicNumber, checks.product);
+  std::uint32_t checkSum = janusMagicNumber - checkProduct * checks.sum;
 
   // display the initial checks to stderr
   consoleOut("initCheckSum:     " + to_hstring(checkSum) + "\n");
@@ -313,33 +1377,37 @@ void DepthTable::certify() const {
 
 // validates the table
 bool DepthTable::validate() const {
-  std::vector<std::size_t> count(16);
-
-  // initialize with what will generate the
-  // two-faced Janus magic number
-  std::uint32_t checkSum = initCheckSum;
-  std::uint32_t checkProduct = initCheckProduct;
 
   consoleOut("Validating...\n");
 
   // compute the total number of positions
   // the product of all depths (constrained to be odd)
   // and a checksum
-  for (std::size_t idx = 0; idx < nSymCoords; ++idx) {
-    uint32_t depth = getDepth(idx);
-    ++count[depth];
-    checkProduct *= (depth << 1) | 1;
-    checkSum += checkProduct;
-  }
+  auto start = std::chrono::steady_clock::now();
+  Checks checks = scan();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  return checkTable(checks, elapsed.count());
+}
+
+// checks the table from its scan
+bool DepthTable::checkTable(const Checks &checks, double seconds) const {
+
+  // start with what will generate the
+  // two-faced Janus magic number
+  std::uint32_t checkSum = initCheckSum + initCheckProduct * checks.sum;
+  std::uint32_t checkProduct = initCheckProduct * checks.product;
 
   // report diagnostics
   for (uint8_t depth = 0; depth < 4; ++depth) {
     consoleOut("depth " + to_ustring(depth) + ": " +
-               to_commastring(count[depth], 14) + "\n");
+               to_commastring(checks.count[depth], 14) + "\n");
   }
 
-  auto totalPositions =
-      std::accumulate(count.begin(), count.end(), static_cast<std::size_t>(0));
+  auto totalPositions = std::accumulate(checks.count.begin(),
+                                        checks.count.end(),
+                                        static_cast<std::size_t>(0));
 
   // did the checks pass?
   bool posCountPassed = totalPositions == nSymCoords;
@@ -353,23 +1421,130 @@ bool DepthTable::validate() const {
              (checkSumPassed ? " passed\n" : " failed\n"));
   consoleOut("checkProduct:        " + to_hstring(checkProduct) +
              (checkProductPassed ? " passed\n" : " failed\n"));
+  consoleOut("validated in " +
+             std::to_string(static_cast<int>(seconds * 1000)) +
+             " ms\n");
 
   // return aggregate status
   return posCountPassed && checkSumPassed && checkProductPassed;
 }
 
-// read the table from disk if it exists, otherwise build and save it.
-void DepthTable::init(std::function<bool(uint8_t *, std::size_t)> load,
-                      std::function<bool(const uint8_t *, std::size_t)> save,
-                      const MoveTable *moveTable) {
+// read and check the header, then the table
+bool DepthTable::loadTable(
+    const std::function<bool(uint8_t *, std::size_t, std::size_t)> &load) {
+
+  std::size_t nBytes = nSymCoords / 4;
+
+  std::vector<uint8_t> page(DepthTableHeader::size);
+  if (!load(page.data(), page.size(), 0)) {
+    return false;
+  }
+
+  DepthTableHeader found(header);
+  if (!found.read(page.data())) {
+    // tables saved before headers were introduced may still be fine
+    consoleOut("depth table has no header; validating it instead...\n");
+    return load(data, nBytes, 0) && validate();
+  }
+
+  auto mismatch = found.mismatch(header);
+  if (!mismatch.empty()) {
+    consoleOut("saved depth table " + mismatch + "; rebuilding it\n");
+    return false;
+  }
+
+  if (!load(data, nBytes, DepthTableHeader::size)) {
+    return false;
+  }
+
+  consoleOut("verifying " + std::to_string(found.getNBlocks()) +
+             " block checksums... ");
+  std::size_t block = found.verify(data);
+  if (block != found.getNBlocks()) {
+    consoleOut("block " + std::to_string(block) +
+               " is damaged; rebuilding table\n");
+    return false;
+  }
+  consoleOut("passed\n");
+
+  if (validateOnLoad && !validate()) {
+    consoleOut("saved depth table failed validation; rebuilding it\n");
+    return false;
+  }
+
+  return true;
+}
+
+// sign and save the header followed by the table
+bool DepthTable::saveTable(
+    const std::function<bool(const uint8_t *, std::size_t, std::size_t)>
+        &save) {
 
-  // expected number of bytes to read
   std::size_t nBytes = nSymCoords / 4;
 
+  header.sign(data);
+  std::vector<uint8_t> page(DepthTableHeader::size);
+  header.write(page.data());
+
+  if (storage->isFileBacked()) {
+    return storage->commit(page.data());
+  }
+
+  return save(page.data(), page.size(), 0) &&
+         save(data, nBytes, DepthTableHeader::size);
+}
+
+// read the table from disk if it exists, otherwise build and save it.
+void DepthTable::init(
+    std::function<bool(uint8_t *, std::size_t, std::size_t)> load,
+    std::function<bool(const uint8_t *, std::size_t, std::size_t)> save,
+    const MoveTable *moveTable,
+    const std::shared_future<void> &moveTableBuilt) {
+
+  // a mapped (or attached) table is ready for use as-is, unless it
+  // fails validation.  then it is dropped and rebuilt (the file it
+  // came from would fail again, so it isn't loaded).
+  bool rebuilding = false;
+  if (storage->isPopulated()) {
+    if (!validateOnLoad || validate()) {
+      return;
+    }
+    consoleOut("mapped depth table failed validation; rebuilding it\n");
+    storage->withdraw();
+    if (shardBytes) {
+      storage = std::make_unique<OutOfCoreStorage>(nSymCoords / 4);
+    } else {
+      storage = DepthStorage::makePrivateStorage(nSymCoords / 4, false);
+    }
+    adata = storage->atomicData();
+    data = storage->data();
+    rebuilding = true;
+  }
+
   // no multi-threading is done at this point
   // we use raw data pointer when invoking user load/save
 
-  if (!load(data, nBytes)) {
+  // a table to be built out of core has no memory to load into
+  if (!data || rebuilding || !loadTable(load)) {
+    moveTableBuilt.wait();
+
+    // a table built out of core is used from its file
+    if (shardBytes) {
+      if (buildInShards(moveTable) && mapTableFile()) {
+        storage->publish();
+        return;
+      }
+
+      consoleOut("COULDN'T BUILD (OR MAP) DEPTH TABLE OUT OF CORE!\n");
+      consoleOut("building it in memory instead...\n");
+      storage = DepthStorage::makePrivateStorage(nSymCoords / 4, false);
+      adata = storage->atomicData();
+      data = storage->data();
+    }
+
+    if (buildingInFile) {
+      buildInFile();
+    }
     build(moveTable);
     if (!validate()) {
       consoleOut("CHECKSUM FAILED!\n");
@@ -377,11 +1552,16 @@ void DepthTable::init(std::function<bool(uint8_t *, std::size_t)> load,
       consoleOut("running certification step just in case...\n");
       certify();
     }
-    if (!save(data, nBytes)) {
+    if (!saveTable(save)) {
       consoleOut("COULDN'T WRITE DEPTH TABLE!\n");
       consoleOut("IS IT READ ONLY?  OUT OF SPACE?\n");
+    } else if (checkpointing) {
+      checkpoint.remove();
     }
   }
+
+  // make the table available to any waiting processes
+  storage->publish();
 }
 
 } // namespace Janus
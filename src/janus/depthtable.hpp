@@ -3,15 +3,25 @@
 #ifndef JANUS_DEPTHTABLE_HPP
 #define JANUS_DEPTHTABLE_HPP
 
+#include "buildcheckpoint.hpp"
+#include "buildtelemetry.hpp"
 #include "constants.hpp"
+#include "depthstorage.hpp"
+#include "depthtableheader.hpp"
+#include "frontier.hpp"
 #include "movetable.hpp"
+#include "numanodes.hpp"
 
 #include <array>
 #include <atomic>
+#include <cstdlib>
 #include <functional>
+#include <future>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 
 namespace Janus {
 
@@ -28,26 +38,109 @@ namespace Janus {
 
 class DepthTable {
 public:
+  // the move table's sizes must be set on entry, but its tables may
+  // still be filling until moveTableBuilt is ready.  They are only
+  // needed if the depth table has to be built.
   DepthTable(const CLIOptions &options, const MoveTable *jmt,
+             std::shared_future<void> moveTableBuilt,
              std::function<void(const std::string &)> console,
-             std::function<bool(uint8_t *, std::size_t)> load,
-             std::function<bool(const uint8_t *, std::size_t)> save)
+             const std::string &filename,
+             std::function<bool(uint8_t *, std::size_t, std::size_t)> load,
+             std::function<bool(const uint8_t *, std::size_t, std::size_t)>
+                 save)
       : nSymCoords(static_cast<std::size_t>(nCornerCoords) *
                    static_cast<std::size_t>(jmt->getNSymEdgeCoords())),
         consoleOut(std::move(console)),
         nTwistsPerMove(selectNTwistsPerMove(options)),
-        buildDepth(selectBuildDepth(options)),
         finalDepth(selectFinalDepth(options)),
+        altDepth(selectAltDepth(options)),
+        nBuildThreads(selectNBuildThreads(options)),
+        buildMode(selectBuildMode(options)),
         initCheckSum(selectInitCheckSum(options)),
         initCheckProduct(selectInitCheckProduct(options)),
         edgePermMask(jmt->getEdgePermMask()),
-        nEdgePermBits(jmt->getNEdgePermBits()) {
+        nEdgePermBits(jmt->getNEdgePermBits()),
+        header(options.qtm.isEnabled(), options.enares.isEnabled(), nSymCoords,
+               edgePermMask, nEdgePermBits,
+               options.compress.isEnabled()
+                   ? DepthTableHeader::Format::compressed
+                   : DepthTableHeader::Format::raw),
+        numaAware(numaNodes.size() > 1 && (options.interleave.isEnabled() ||
+                                           options.replicate.isEnabled())),
+        validateOnLoad(options.validate.isEnabled()),
+        checkpointing(options.checkpoint.isEnabled()), checkpoint(filename),
+        telemetry(options.telemetry.isSet() ? options.telemetry.c_str() : ""),
+        buildingInFile(selectBuildingInFile(options)), tableFilename(filename),
+        shardBytes(selectShardBytes(options)) {
+
+    if (options.buildmode.isSet() && buildMode == BuildMode::direct &&
+        std::string(options.buildmode.c_str()) != "direct") {
+      consoleOut("unknown build mode '" +
+                 std::string(options.buildmode.c_str()) +
+                 "'; using 'direct'\n");
+    }
+
+    if (options.inplace.isEnabled() && !buildingInFile) {
+      consoleOut("'inplace' needs a single, private, uncompressed table "
+                 "file; building in memory instead\n");
+    }
+
+    if (telemetry.failed()) {
+      consoleOut("couldn't open " + telemetry.getPath() +
+                 " for build telemetry\n");
+    }
+
+    if (options.shardsize.isSet() && !shardBytes) {
+      consoleOut("'shardsize' needs a single, private, uncompressed table "
+                 "file; building in memory instead\n");
+    }
+
+    storage = DepthStorage::makeDepthStorage(options, filename, header,
+                                             consoleOut, shardBytes != 0);
+    adata = storage->atomicData();
+    data = storage->data();
+
+    // spread the table across nodes before it is first touched
+    if (numaAware && options.interleave.isEnabled() && data &&
+        !storage->isPopulated()) {
+      consoleOut("interleaving depth table across " +
+                 std::to_string(numaNodes.size()) + " nodes\n");
+      numaNodes.interleave(data, nSymCoords / 4);
+    }
+
+    init(std::move(load), std::move(save), jmt, moveTableBuilt);
+
+    if (numaAware && options.replicate.isEnabled()) {
+      replicate(options.hugepages.isEnabled());
+    }
+  }
+
+  // pins the calling thread to a NUMA node (chosen round-robin by
+  // the specified thread number) and has getLocalDepth() read that
+  // node's replica of the table.  Does nothing on single-node hosts
+  // or when neither interleaving nor replication is requested.
+  void bindThread(std::size_t thread) const;
 
-    atomicData = std::make_unique<std::atomic_uint8_t[]>(nSymCoords / 4);
-    adata = atomicData.get();
-    data = const_cast<uint8_t *>(reinterpret_cast<const uint8_t *>(&adata[0]));
+  // returns the depth for the specified corner and edge indices
+  // from the calling thread's node-local replica (if any)
+  uint8_t getLocalDepth(std::size_t cidx, std::size_t eidx) const {
+    std::size_t idx = fullIdx(cidx, eidx);
+    const uint8_t *table = localData ? localData : data;
+    return (table[idx >> 2] >> ((idx & 3) << 1)) & 0x3;
+  }
 
-    init(std::move(load), std::move(save), jmt);
+  // hints that getLocalDepth() will soon be called with the
+  // specified corner and edge indices, so that the reads of several
+  // entries may overlap rather than wait on each other
+  void prefetchLocalDepth(std::size_t cidx, std::size_t eidx) const {
+#if defined(__GNUC__)
+    std::size_t idx = fullIdx(cidx, eidx);
+    const uint8_t *table = localData ? localData : data;
+    __builtin_prefetch(table + (idx >> 2));
+#else
+    (void)cidx;
+    (void)eidx;
+#endif
   }
 
   // returns the depth for the specified corner and edge indices
@@ -94,8 +187,41 @@ private:
     atomic_fetch_and(&adata[loc], mask);
   }
 
+  // sets the depth at the specified index in a thread-safe manner if
+  // it is unreached.  returns true if it was.
+  bool claimDepth(std::size_t idx, uint8_t value) {
+    std::size_t loc = idx >> 2;
+    unsigned shift = (idx & 3) << 1;
+
+    uint8_t mask = ~((~value & 0x03) << shift);
+
+    return ((atomic_fetch_and(&adata[loc], mask) >> shift) & 0x3) == 0x3;
+  }
+
   // the following items probably could be moved to a new builder class
 
+  // invokes visit(idx) for each entry one twist away from the
+  // specified entry, along with any entries equivalent to it
+  template <class Visit>
+  void forEachNeighbor(const MoveTable *moveTable, std::size_t cidx,
+                       std::size_t eidx, Visit visit) const;
+
+  // invokes visit(cidx, eidx) for each entry within the specified edge
+  // index range that the previous pass reached
+  template <class Visit>
+  void forEachReached(uint8_t pass, std::size_t start_eidx,
+                      std::size_t stop_eidx, Visit visit) const;
+
+  // records a position reached by the current pass (if tracked)
+  void markReached(std::size_t idx) {
+    if (frontier) {
+      frontier->mark(idx);
+    }
+  }
+
+  // start tracking the frontier of each pass (if there's room)
+  void trackFrontier();
+
   // search all entries within the specified edge index range for
   // values that match the previous pass (depth) and mark any yet
   // unreached entry one twist away with the current pass
@@ -108,13 +234,62 @@ private:
   std::size_t cleanupWorker(const MoveTable *moveTable, uint8_t pass,
                             std::size_t start_eidx, std::size_t stop_eidx);
 
-  // build table in parallel using the specified worker
-  void pbuild(std::size_t (DepthTable::*worker)(const MoveTable *moveTable,
-                                                uint8_t pass,
-                                                std::size_t start_eidx,
-                                                std::size_t stop_eidx),
-              uint8_t startdepth, uint8_t stopdepth, bool pruned,
-              const MoveTable *moveTable);
+  // time spent and work claimed by one thread during a build pass
+  struct ThreadLoad {
+    std::size_t nChunks = 0;
+    double seconds = 0;
+  };
+
+  // summarizes how evenly the work of a pass was spread over threads
+  static std::string loadBalance(const std::vector<ThreadLoad> &loads);
+
+  // run a task on each build thread (passing the thread number) and
+  // return the sum of what they return
+  std::size_t runThreads(const std::function<std::size_t(std::size_t)> &task,
+                         std::vector<ThreadLoad> &loads) const;
+
+  // run a pass of the worker over chunks of the table
+  std::size_t chunkPass(std::size_t (DepthTable::*worker)(
+                            const MoveTable *moveTable, uint8_t pass,
+                            std::size_t start_eidx, std::size_t stop_eidx),
+                        const MoveTable *moveTable, uint8_t pass,
+                        std::vector<ThreadLoad> &loads);
+
+  // run an expanding pass by gathering neighbors into buckets by
+  // region of the table, then marking each region with one thread
+  std::size_t scatterPass(const MoveTable *moveTable, uint8_t pass,
+                          std::vector<ThreadLoad> &loads);
+
+  // run an expanding pass where each region of the table is marked
+  // only by the thread that owns it; other threads send it neighbors
+  // that lie in its regions
+  std::size_t ownerPass(const MoveTable *moveTable, uint8_t pass,
+                        std::vector<ThreadLoad> &loads);
+
+  // build a pass of the table in parallel using the specified worker,
+  // given the number of positions it expands (or searches from) and
+  // the number unreached beforehand.  returns the number of positions
+  // it reached.
+  std::size_t buildPass(std::size_t (DepthTable::*worker)(
+                            const MoveTable *moveTable, uint8_t pass,
+                            std::size_t start_eidx, std::size_t stop_eidx),
+                        uint8_t pass, bool pruned, const MoveTable *moveTable,
+                        std::size_t nExpanding, std::size_t nUnreached);
+
+  // report a pass of the build to the console and telemetry
+  void recordPass(BuildTelemetry::Pass &record,
+                  const std::vector<ThreadLoad> &loads);
+
+  // true if searching the unreached positions for the next pass
+  // looks cheaper than expanding those the last pass reached
+  static bool searchIsCheaper(std::size_t nReachedLastPass,
+                              std::size_t nUnreached);
+
+  // collect the positions rbuild() would recurse into the specified
+  // number of levels below a given coordinate
+  void rsplit(const MoveTable *moveTable, std::size_t cidx, std::size_t eidx,
+              uint8_t depth, uint8_t currentDepth, uint8_t levels,
+              std::vector<std::pair<uint32_t, uint32_t>> &roots) const;
 
   // recursively build the table starting from a given coordinate
   std::size_t rbuild(const MoveTable *moveTable, std::size_t cidx,
@@ -127,19 +302,85 @@ private:
   // main entry point for depth table building
   void build(const MoveTable *moveTable);
 
+  // save the table as built through the specified pass so that an
+  // interrupted build may resume from it (if checkpointing), and write
+  // it back to the table file (if building in it)
+  void saveCheckpoint(uint8_t pass);
+
+  // move the table into a mapping of the table file before building
+  // it.  returns false (leaving the table in memory) if it can't be.
+  bool buildInFile();
+
+  // build the table out of core, a shard at a time, in the table
+  // file.  returns false if the file couldn't be written.
+  bool buildInShards(const MoveTable *moveTable);
+
+  // map the table file in place of the table in memory.  returns
+  // false if it can't be.
+  bool mapTableFile();
+
   // sets all entries of table to max val (3).
   void clear();
 
+  // checks accumulated over a range of the table.
+  //
+  // validate() folds each depth d into the checks in table order via
+  //   checkProduct *= 2d + 1;  checkSum += checkProduct;
+  // Over a range of entries this amounts to
+  //   checkSum += checkProduct * sum;  checkProduct *= product;
+  // so ranges may be scanned independently and appended in order.
+  struct Checks {
+    uint32_t sum = 0;
+    uint32_t product = 1;
+    std::array<std::size_t, 4> count{};
+
+    // append the checks of the range that follows
+    void append(const Checks &next) {
+      sum += product * next.sum;
+      product *= next.product;
+      for (std::size_t depth = 0; depth < count.size(); ++depth) {
+        count[depth] += next.count[depth];
+      }
+    }
+  };
+
+  // scan the specified bytes of the table
+  static Checks scanBytes(const uint8_t *table, std::size_t begin,
+                          std::size_t end);
+
+  // scan the specified number of bytes of the table in parallel
+  Checks scan(const uint8_t *table, std::size_t nBytes) const;
+
+  // scan the whole table in parallel
+  Checks scan() const { return scan(data, nSymCoords / 4); }
+
   // validate the table
   bool validate() const;
 
+  // report the checks of the whole table and whether they pass
+  bool checkTable(const Checks &checks, double seconds) const;
+
   // generate a checksum and checkproduct to validate the table
   void certify() const;
 
+  // copy the table to memory local to each NUMA node
+  void replicate(bool hugePages);
+
   // read the table if possible, otherwise build and save it
-  void init(std::function<bool(uint8_t *, std::size_t)> load,
-            std::function<bool(const uint8_t *, std::size_t)> save,
-            const MoveTable *moveTable);
+  void init(std::function<bool(uint8_t *, std::size_t, std::size_t)> load,
+            std::function<bool(const uint8_t *, std::size_t, std::size_t)> save,
+            const MoveTable *moveTable,
+            const std::shared_future<void> &moveTableBuilt);
+
+  // read the header and, if compatible, the table.  returns false if
+  // the table must be rebuilt.
+  bool loadTable(
+      const std::function<bool(uint8_t *, std::size_t, std::size_t)> &load);
+
+  // sign and save the header followed by the table (or just the
+  // header if the table was built in its file)
+  bool saveTable(const std::function<bool(const uint8_t *, std::size_t,
+                                          std::size_t)> &save);
 
   // read the table from the file
   bool load(const char *filename);
@@ -149,7 +390,7 @@ private:
 
   // database needs to be atomic when creating table
   //  std::array<std::atomic_uint8_t, nSymCoords / 4> adata;
-  std::unique_ptr<std::atomic_uint8_t[]> atomicData;
+  std::unique_ptr<DepthStorage> storage;
   std::atomic_uint8_t *adata;
   uint8_t *data;
 
@@ -176,14 +417,6 @@ private:
     return options.qtm.isEnabled() ? nQuarterTwists : nFaceTwists;
   }
 
-  // when to switch to searching for empties...
-  const uint8_t buildDepth;
-  uint8_t selectBuildDepth(const CLIOptions &options) {
-    const uint8_t buildDepthQTM = 13;
-    const uint8_t buildDepthFTM = 11;
-    return options.qtm.isEnabled() ? buildDepthQTM : buildDepthFTM;
-  }
-
   // last depth that can contain entries
   const uint8_t finalDepth;
   uint8_t selectFinalDepth(const CLIOptions &options) {
@@ -192,6 +425,50 @@ private:
     return options.qtm.isEnabled() ? finalDepthQTM : finalDepthFTM;
   }
 
+  // number of passes built recursively from home before the table
+  // is scanned pass by pass
+  const uint8_t altDepth;
+  uint8_t selectAltDepth(const CLIOptions &options) const {
+    // passes the recursion is tuned for
+    const unsigned long altDepthDefault = 7;
+
+    unsigned long depth =
+        options.altdepth.isSet()
+            ? std::strtoul(options.altdepth.c_str(), nullptr, 10)
+            : altDepthDefault;
+    return static_cast<uint8_t>(
+        std::min<unsigned long>(std::max(depth, 1UL), finalDepth));
+  }
+
+  // number of threads used for each parallel build pass
+  const std::size_t nBuildThreads;
+  std::size_t selectNBuildThreads(const CLIOptions &options) {
+    // number of threads to use if hardware_concurrency() returns 0
+    const std::size_t nDefaultBuildThreads = 16;
+
+    std::size_t nThreads =
+        options.threads.isSet()
+            ? std::strtoul(options.threads.c_str(), nullptr, 10)
+            : std::thread::hardware_concurrency();
+    return nThreads ? nThreads : nDefaultBuildThreads;
+  }
+
+  // how expanding build passes update the table
+  //   direct:   each thread marks neighbors as it finds them
+  //   scatter:  neighbors are gathered and sorted by region, then
+  //             each region is marked by a single thread
+  //   owner:    each region is expanded and marked by the thread that
+  //             owns it; other threads send it their neighbors
+  enum class BuildMode { direct, scatter, owner };
+  const BuildMode buildMode;
+  static BuildMode selectBuildMode(const CLIOptions &options) {
+    std::string mode = options.buildmode.isSet() ? options.buildmode.c_str()
+                                                 : "direct";
+    return mode == "scatter" ? BuildMode::scatter
+           : mode == "owner" ? BuildMode::owner
+                             : BuildMode::direct;
+  }
+
   // table checks
   //
   //    magic number for Janus depth table checks.
@@ -228,6 +505,56 @@ private:
   // permutation mask and number of bits copied from depthtable
   const uint8_t edgePermMask;
   const uint8_t nEdgePermBits;
+
+  // describes the table when saved
+  DepthTableHeader header;
+
+  // NUMA placement of the table and of the threads using it
+  const NumaNodes numaNodes;
+  const bool numaAware;
+
+  // validate the table whenever it's loaded (or mapped or attached)
+  const bool validateOnLoad;
+
+  // positions reached by the previous pass (while building)
+  std::unique_ptr<Frontier> frontier;
+
+  // save the table after each build pass and resume from the last
+  const bool checkpointing;
+  const BuildCheckpoint checkpoint;
+
+  // per-pass measurements of the build
+  BuildTelemetry telemetry;
+
+  // build the table in a mapping of the table file itself
+  const bool buildingInFile;
+  static bool selectBuildingInFile(const CLIOptions &options) {
+    return options.inplace.isEnabled() && !options.stripe.isSet() &&
+           !options.compress.isEnabled() && !options.share.isEnabled();
+  }
+  const std::string tableFilename;
+
+  // bytes of the table held in memory at a time when building it out
+  // of core (a multiple of the header's block size), or zero to build
+  // the whole table in memory
+  const std::size_t shardBytes;
+  std::size_t selectShardBytes(const CLIOptions &options) const {
+    if (!options.shardsize.isSet() || options.stripe.isSet() ||
+        options.compress.isEnabled() || options.share.isEnabled()) {
+      return 0;
+    }
+    std::size_t blockSize = header.getBlockSize();
+    std::size_t bytes = std::strtoull(options.shardsize.c_str(), nullptr, 10)
+                        << 20;
+    return std::max(bytes / blockSize, static_cast<std::size_t>(1)) *
+           blockSize;
+  }
+
+  // per-node copies of the table (when replicated)
+  std::vector<std::unique_ptr<DepthStorage>> replicas;
+
+  // table read by getLocalDepth() on the current thread
+  static thread_local const uint8_t *localData;
 };
 
 } // namespace Janus
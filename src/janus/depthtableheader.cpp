@@ -0,0 +1,241 @@
+// Copyright (C) 2022 Greg Dionne
+// Distributed under MIT License
+#include "depthtableheader.hpp"
+#include "strutils.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <future>
+#include <thread>
+
+namespace Janus {
+
+// layout of the header page:
+//    0  magic           (8 bytes)
+//    8  version         (4 bytes)
+//   12  header size     (4 bytes)
+//   16  metric          (4 bytes: 0 = FTM, 1 = QTM)
+//   20  enares          (4 bytes)
+//   24  nSymCoords      (8 bytes)
+//   32  edgePermMask    (4 bytes)
+//   36  nEdgePermBits   (4 bytes)
+//   40  format          (4 bytes)
+//   44  number of blocks (4 bytes)
+//   48  block size      (8 bytes)
+//   56  page checksum   (8 bytes)
+//   64  last pass built (4 bytes: 0 = finished table)
+//   68  reserved        (4 bytes)
+//   72  block checksums (8 bytes each)
+static const char magic[8] = {'J', 'A', 'N', 'U', 'S', 'D', 'T', 'B'};
+static const uint32_t currentVersion = 1;
+static const std::size_t checksumOffset = 56;
+static const std::size_t passOffset = 64;
+static const std::size_t blockSumsOffset = 72;
+static const std::size_t maxBlocks =
+    (DepthTableHeader::size - blockSumsOffset) / 8;
+
+static void put32(uint8_t *p, uint32_t x) {
+  for (int i = 0; i < 4; ++i) {
+    p[i] = static_cast<uint8_t>(x >> (8 * i));
+  }
+}
+
+static void put64(uint8_t *p, uint64_t x) {
+  for (int i = 0; i < 8; ++i) {
+    p[i] = static_cast<uint8_t>(x >> (8 * i));
+  }
+}
+
+static uint32_t get32(const uint8_t *p) {
+  uint32_t x = 0;
+  for (int i = 3; i >= 0; --i) {
+    x = x << 8 | p[i];
+  }
+  return x;
+}
+
+static uint64_t get64(const uint8_t *p) {
+  uint64_t x = 0;
+  for (int i = 7; i >= 0; --i) {
+    x = x << 8 | p[i];
+  }
+  return x;
+}
+
+DepthTableHeader::DepthTableHeader(bool quarterTurns, bool noNoses,
+                                   std::size_t nCoords, uint8_t permMask,
+                                   uint8_t nPermBits, Format tableFormat)
+    : version(currentVersion), qtm(quarterTurns), enares(noNoses),
+      nSymCoords(nCoords), edgePermMask(permMask), nEdgePermBits(nPermBits),
+      format(tableFormat), pass(0) {
+
+  // start with 64 MB blocks, doubling until the checksums fit
+  std::size_t nBytes = getNBytes();
+  blockSize = static_cast<std::size_t>(64) << 20;
+  while ((nBytes + blockSize - 1) / blockSize > maxBlocks) {
+    blockSize <<= 1;
+  }
+  blockSums.resize((nBytes + blockSize - 1) / blockSize);
+}
+
+bool DepthTableHeader::read(const uint8_t *page) {
+  if (std::memcmp(page, magic, sizeof(magic)) != 0 ||
+      get32(page + 8) != currentVersion || get32(page + 12) != size ||
+      get64(page + checksumOffset) != pageChecksum(page)) {
+    return false;
+  }
+
+  std::size_t nBlocks = get32(page + 44);
+  if (nBlocks > maxBlocks) {
+    return false;
+  }
+
+  version = currentVersion;
+  qtm = get32(page + 16) != 0;
+  enares = get32(page + 20) != 0;
+  nSymCoords = static_cast<std::size_t>(get64(page + 24));
+  edgePermMask = static_cast<uint8_t>(get32(page + 32));
+  nEdgePermBits = static_cast<uint8_t>(get32(page + 36));
+  format = static_cast<Format>(get32(page + 40));
+  blockSize = static_cast<std::size_t>(get64(page + 48));
+  pass = static_cast<uint8_t>(get32(page + passOffset));
+
+  blockSums.resize(nBlocks);
+  for (std::size_t block = 0; block < nBlocks; ++block) {
+    blockSums[block] = get64(page + blockSumsOffset + 8 * block);
+  }
+
+  return true;
+}
+
+void DepthTableHeader::write(uint8_t *page) const {
+  std::memset(page, 0, size);
+  std::memcpy(page, magic, sizeof(magic));
+  put32(page + 8, currentVersion);
+  put32(page + 12, static_cast<uint32_t>(size));
+  put32(page + 16, qtm ? 1 : 0);
+  put32(page + 20, enares ? 1 : 0);
+  put64(page + 24, nSymCoords);
+  put32(page + 32, edgePermMask);
+  put32(page + 36, nEdgePermBits);
+  put32(page + 40, static_cast<uint32_t>(format));
+  put32(page + 44, static_cast<uint32_t>(blockSums.size()));
+  put64(page + 48, blockSize);
+  put32(page + passOffset, pass);
+  for (std::size_t block = 0; block < blockSums.size(); ++block) {
+    put64(page + blockSumsOffset + 8 * block, blockSums[block]);
+  }
+  put64(page + checksumOffset, pageChecksum(page));
+}
+
+std::string DepthTableHeader::mismatch(const DepthTableHeader &expected) const {
+  if (qtm != expected.qtm) {
+    return std::string("built for the ") + (qtm ? "quarter" : "face") +
+           "-turn metric";
+  }
+  if (enares != expected.enares) {
+    return enares ? "built with 'enares'" : "built without 'enares'";
+  }
+  if (nSymCoords != expected.nSymCoords) {
+    return "has " + to_commastring(nSymCoords, 0) + " positions instead of " +
+           to_commastring(expected.nSymCoords, 0);
+  }
+  if (edgePermMask != expected.edgePermMask ||
+      nEdgePermBits != expected.nEdgePermBits) {
+    return "uses a different edge coordinate layout";
+  }
+  if (blockSize != expected.blockSize ||
+      blockSums.size() != expected.blockSums.size()) {
+    return "uses a different block size";
+  }
+  if (pass != expected.pass) {
+    return pass ? "is unfinished (built through pass " +
+                      std::to_string(pass) + ")"
+                : "is already finished";
+  }
+  return "";
+}
+
+void DepthTableHeader::sign(const uint8_t *table) {
+  blockSums = blockChecksums(table);
+}
+
+void DepthTableHeader::signBlocks(const uint8_t *bytes, std::size_t offset,
+                                  std::size_t n) {
+  for (std::size_t begin = 0; begin < n; begin += blockSize) {
+    blockSums[(offset + begin) / blockSize] =
+        checksum(bytes + begin, std::min(blockSize, n - begin));
+  }
+}
+
+std::size_t DepthTableHeader::verify(const uint8_t *table) const {
+  auto sums = blockChecksums(table);
+  auto bad = std::mismatch(sums.begin(), sums.end(), blockSums.begin()).first;
+  return static_cast<std::size_t>(bad - sums.begin());
+}
+
+// FNV-1a over 64-bit words in four independent lanes, folded with
+// the length.  This detects damage rather than tampering.
+uint64_t DepthTableHeader::checksum(const uint8_t *block, std::size_t n) {
+  const uint64_t basis = 0xCBF29CE484222325ULL;
+  const uint64_t prime = 0x100000001B3ULL;
+
+  uint64_t lanes[4] = {basis, basis ^ 1, basis ^ 2, basis ^ 3};
+
+  std::size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    for (int lane = 0; lane < 4; ++lane) {
+      uint64_t word;
+      std::memcpy(&word, block + i + 8 * lane, sizeof(word));
+      lanes[lane] = (lanes[lane] ^ word) * prime;
+    }
+  }
+  for (; i < n; ++i) {
+    lanes[0] = (lanes[0] ^ block[i]) * prime;
+  }
+
+  uint64_t sum = n;
+  for (auto lane : lanes) {
+    sum = (sum ^ lane) * prime;
+    sum ^= sum >> 29;
+  }
+  return sum;
+}
+
+std::vector<uint64_t>
+DepthTableHeader::blockChecksums(const uint8_t *table) const {
+  const std::size_t nBytes = getNBytes();
+  const std::size_t nBlocks = blockSums.size();
+  std::vector<uint64_t> sums(nBlocks);
+
+  std::atomic<std::size_t> nextBlock{0};
+  auto worker = [&]() {
+    for (std::size_t block = nextBlock++; block < nBlocks;
+         block = nextBlock++) {
+      std::size_t begin = block * blockSize;
+      sums[block] =
+          checksum(table + begin, std::min(blockSize, nBytes - begin));
+    }
+  };
+
+  std::size_t nThreads = std::max(1U, std::thread::hardware_concurrency());
+  std::vector<std::future<void>> workers(std::min(nThreads, nBlocks));
+  for (auto &w : workers) {
+    w = std::async(std::launch::async, worker);
+  }
+  for (auto &w : workers) {
+    w.get();
+  }
+
+  return sums;
+}
+
+uint64_t DepthTableHeader::pageChecksum(const uint8_t *page) {
+  uint8_t copy[size];
+  std::memcpy(copy, page, size);
+  std::memset(copy + checksumOffset, 0, 8);
+  return checksum(copy, size);
+}
+
+} // namespace Janus
@@ -0,0 +1,93 @@
+// Copyright (C) 2022 Greg Dionne
+// Distributed under MIT License
+#ifndef JANUS_DEPTHTABLEHEADER_HPP
+#define JANUS_DEPTHTABLEHEADER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Janus {
+
+// The first page of a saved depth table.
+//
+// The header records the options and coordinate layout the table
+// was built with so that an incompatible table can be rejected
+// before it is read.  It also holds a checksum of each block of the
+// table so that a damaged table is detected as soon as it is loaded
+// rather than by a full validation.
+//
+// All fields are stored little endian at fixed offsets.  The same
+// header marks the checkpoints saved while the table is being built.
+class DepthTableHeader {
+public:
+  // bytes reserved for the header; the table follows it
+  constexpr static std::size_t size = 4096;
+
+  // how the table following the header is stored
+  enum class Format : uint32_t { raw = 0, compressed = 1 };
+
+  DepthTableHeader(bool quarterTurns, bool noNoses, std::size_t nCoords,
+                   uint8_t permMask, uint8_t nPermBits, Format tableFormat);
+
+  // reads the header from a page.  returns false if the page does not
+  // hold an intact header of a known version.
+  bool read(const uint8_t *page);
+
+  // writes the header to a page
+  void write(uint8_t *page) const;
+
+  // describes how this header differs from the expected one.
+  // returns an empty string when the tables are interchangeable.
+  std::string mismatch(const DepthTableHeader &expected) const;
+
+  // computes the checksum of each block of the table
+  void sign(const uint8_t *table);
+
+  // computes the checksums of the blocks within the n bytes of the
+  // table at the specified offset (a multiple of the block size) from
+  // a copy of those bytes
+  void signBlocks(const uint8_t *bytes, std::size_t offset, std::size_t n);
+
+  // returns the index of the first block of the table that does not
+  // match its checksum, or getNBlocks() if all of them do.
+  std::size_t verify(const uint8_t *table) const;
+
+  // the last build pass held by a table saved before it was finished
+  // (zero once the table is finished)
+  uint8_t getPass() const { return pass; }
+  void setPass(uint8_t lastPass) { pass = lastPass; }
+
+  Format getFormat() const { return format; }
+  void setFormat(Format tableFormat) { format = tableFormat; }
+  std::size_t getNBytes() const { return nSymCoords / 4; }
+  std::size_t getNBlocks() const { return blockSums.size(); }
+  std::size_t getBlockSize() const { return blockSize; }
+
+private:
+  // checksum of a block
+  static uint64_t checksum(const uint8_t *block, std::size_t n);
+
+  // checksum of each block computed in parallel
+  std::vector<uint64_t> blockChecksums(const uint8_t *table) const;
+
+  // checksum of the serialized header (excluding the checksum itself)
+  static uint64_t pageChecksum(const uint8_t *page);
+
+  uint32_t version;
+  bool qtm;
+  bool enares;
+  std::size_t nSymCoords;
+  uint8_t edgePermMask;
+  uint8_t nEdgePermBits;
+  Format format;
+  uint8_t pass;
+
+  // bytes covered by each block checksum
+  std::size_t blockSize;
+  std::vector<uint64_t> blockSums;
+};
+
+} // namespace Janus
+#endif
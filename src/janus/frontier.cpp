@@ -0,0 +1,18 @@
+// Copyright (C) 2022 Greg Dionne
+// Distributed under MIT License
+#include "frontier.hpp"
+
+#include <algorithm>
+
+namespace Janus {
+
+Frontier::Frontier(std::size_t nPositions)
+    : previous(nPositions / 64), current(nPositions / 64) {}
+
+void Frontier::advance() {
+  std::swap(previous, current);
+  std::fill(current.begin(), current.end(), 0);
+  known = true;
+}
+
+} // namespace Janus
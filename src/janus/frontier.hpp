@@ -0,0 +1,65 @@
+// Copyright (C) 2022 Greg Dionne
+// Distributed under MIT License
+#ifndef JANUS_FRONTIER_HPP
+#define JANUS_FRONTIER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Janus {
+
+// The positions newly reached by a build pass.
+//
+// Depths are stored modulo three, so the depth table alone can't tell
+// the positions reached by the previous pass from those reached three
+// (or six...) passes earlier.  A frontier keeps one bit per position
+// for the positions reached by the previous pass, and another for
+// those being reached by the current pass.  advance() makes the
+// latter the former at the end of each pass.
+//
+// Something like:
+//
+//   Frontier frontier(nPositions);
+//   for (pass...) {
+//     for (each position whose frontier.word() bit is set)
+//       for (each neighbor newly reached)
+//         frontier.mark(neighbor);
+//     frontier.advance();
+//   }
+class Frontier {
+public:
+  // tracks the specified number of positions (a multiple of 64)
+  explicit Frontier(std::size_t nPositions);
+
+  // bytes needed to track the specified number of positions
+  static std::size_t memoryNeeded(std::size_t nPositions) {
+    return 2 * (nPositions / 64) * sizeof(uint64_t);
+  }
+
+  // true if the previous pass was tracked
+  bool isKnown() const { return known; }
+
+  // positions [64 * w, 64 * w + 64) reached by the previous pass,
+  // lowest position first
+  uint64_t word(std::size_t w) const { return previous[w]; }
+
+  // marks a position reached by the current pass (thread-safe)
+  void mark(std::size_t idx) {
+    auto *words = reinterpret_cast<std::atomic<uint64_t> *>(current.data());
+    words[idx >> 6].fetch_or(uint64_t(1) << (idx & 63),
+                             std::memory_order_relaxed);
+  }
+
+  // ends the current pass
+  void advance();
+
+private:
+  std::vector<uint64_t> previous;
+  std::vector<uint64_t> current;
+  bool known = false;
+};
+
+} // namespace Janus
+#endif
@@ -9,6 +9,7 @@
 #include "constants.hpp"
 #include "cornercoordinate.hpp" // only for nCornerCoords
 #include "cubeindex.hpp"
+#include "twisttable.hpp"
 
 namespace Janus {
 
@@ -17,8 +18,7 @@ public:
   MoveTable(uint8_t numJanusPerms, uint8_t numEdgePermBits,
             uint16_t numSymEdgePositions, uint32_t numSymEdgeCoords,
             uint8_t numCubeSyms, uint32_t homeCorner, uint32_t homeEdge)
-      : cornerTwistTable(nFaceTwists, nCornerCoords),
-        edgeTwistTable(nFaceTwists, numSymEdgeCoords),
+      : cornerTwistTable(nCornerCoords), edgeTwistTable(numSymEdgeCoords),
         cornerPermuteTable(numJanusPerms, nCornerCoords),
         edgePermuteTable(numJanusPerms, numSymEdgeCoords),
         symmetryPermuteTable(numJanusPerms, numCubeSyms),
@@ -33,16 +33,25 @@ public:
     return {move(cube.x, twist), move(cube.y, twist), move(cube.z, twist)};
   }
 
+  // as above, but with the number of edge permutation bits of the
+  // table known when compiled
+  template <uint8_t nPermBits>
+  CubeIndex move(const CubeIndex &cube, uint8_t twist) const {
+    return {move<nPermBits>(cube.x, twist), move<nPermBits>(cube.y, twist),
+            move<nPermBits>(cube.z, twist)};
+  }
+
   // tables perform the twist in a Janus with both
-  // permutation=0 and symmetry=0
+  // permutation=0 and symmetry=0.  all twists of an index
+  // share a cache line.
   //
   //   corner twist table returns a corner index
-  Array2D<uint32_t> cornerTwistTable;
+  TwistTable cornerTwistTable;
 
   //   edge twist table returns a (permuted) edge index
   //   shifted left.  the permutation needed
   //   is encoded in the lower four or five bits
-  Array2D<uint32_t> edgeTwistTable;
+  TwistTable edgeTwistTable;
 
   // tables that perform a permutation on the specified
   // corners, edges, and symmetries
@@ -67,12 +76,38 @@ public:
   uint8_t getNEdgePermBits() const { return nEdgePermBits; }
 
   uint32_t getHomeCornerIndex() const { return homeCornerIndex; }
+
+  // edge permutation bits with and without the noses
+  static constexpr uint8_t nEdgePermBitsEnares = 5;
+  static constexpr uint8_t nEdgePermBitsNaso = 4;
+
   uint32_t getHomeEdgeIndex() const { return homeEdgeIndex; }
 
 private:
   // perform a move on a Janus index:
   Index move(const Index &janus, uint8_t twist) const;
 
+  template <uint8_t nPermBits>
+  Index move(const Index &janus, uint8_t twist) const {
+
+    // transform the twist into the local frame of the Janus
+    twist = twistSymmetryTable(janus.symmetry, twist);
+
+    // perform the transformed twist on the indices
+    uint32_t cvalue = cornerTwistTable(twist, janus.corners);
+    uint32_t evalue = edgeTwistTable(twist, janus.edges);
+
+    // get resulting edge index and permutation
+    uint32_t eidx = evalue >> nPermBits;
+    uint8_t permNeeded = evalue & ((1 << nPermBits) - 1);
+
+    // perform needed permutation on the corner and symmetry
+    uint32_t cidx = cornerPermuteTable(permNeeded, cvalue);
+    uint8_t symmetry = symmetryPermuteTable(permNeeded, janus.symmetry);
+
+    return {cidx, eidx, symmetry};
+  }
+
   const uint32_t nSymEdgeCoords; // nSymEdgePositions * nEdgeFlips
 
   // naso:                            (enares)  (cum naso)
@@ -71,20 +71,27 @@ void MoveTableBuilder::initHomeIndices() {
 
 // constructs and returns a move table
 std::unique_ptr<MoveTable> MoveTableBuilder::build() {
-  auto moveTable = std::make_unique<MoveTable>(
-      nJanusPerms, nEdgePermBits, nSymEdgePositions, nSymEdgeCoords, nCubeSyms,
-      homeCornerIndex, homeEdgeIndex);
-  buildCornerPermuteTable(moveTable->cornerPermuteTable);
-  buildCornerTwistTable(moveTable->cornerTwistTable);
-  buildEdgeTwistTable(moveTable->edgeTwistTable);
-  buildSymmetryPermuteTable(moveTable->symmetryPermuteTable);
-  buildTwistSymmetryTable(moveTable->twistSymmetryTable);
-  buildEquivalentEdgePermutationTable(
-      moveTable->equivalentEdgePermutationTable);
-  buildEdgePermuteTable(moveTable->edgePermuteTable);
+  auto moveTable = allocate();
+  fill(*moveTable);
   return moveTable;
 }
 
+std::unique_ptr<MoveTable> MoveTableBuilder::allocate() const {
+  return std::make_unique<MoveTable>(nJanusPerms, nEdgePermBits,
+                                     nSymEdgePositions, nSymEdgeCoords,
+                                     nCubeSyms, homeCornerIndex, homeEdgeIndex);
+}
+
+void MoveTableBuilder::fill(MoveTable &moveTable) {
+  buildCornerPermuteTable(moveTable.cornerPermuteTable);
+  buildCornerTwistTable(moveTable.cornerTwistTable);
+  buildEdgeTwistTable(moveTable.edgeTwistTable);
+  buildSymmetryPermuteTable(moveTable.symmetryPermuteTable);
+  buildTwistSymmetryTable(moveTable.twistSymmetryTable);
+  buildEquivalentEdgePermutationTable(moveTable.equivalentEdgePermutationTable);
+  buildEdgePermuteTable(moveTable.edgePermuteTable);
+}
+
 // builds the table that performs whole-cube rotation/inversion
 // of the edges for the given symmetry
 void MoveTableBuilder::buildEquivalentEdgePermutationTable(
@@ -228,8 +235,7 @@ void MoveTableBuilder::buildCornerPermuteTable(
 }
 
 // build table that performs specified twist on the corners
-void MoveTableBuilder::buildCornerTwistTable(
-    Array2D<uint32_t> &cornerTwistTableX) {
+void MoveTableBuilder::buildCornerTwistTable(TwistTable &cornerTwistTableX) {
   for (uint8_t position = 0; position < nCornerPositions; ++position) {
     for (uint16_t spin = 0; spin < nCornerSpins; ++spin) {
 
@@ -239,7 +245,7 @@ void MoveTableBuilder::buildCornerTwistTable(
 
       for (uint8_t twist = 0; twist < nFaceTwists; ++twist) {
         CornerCoordinate pjcc = jcm2jcc(jcm.move(twist));
-        cornerTwistTableX(twist, cidx) = pjcc.tableIndex();
+        cornerTwistTableX.set(twist, cidx, pjcc.tableIndex());
       }
     }
   }
@@ -267,7 +273,7 @@ void MoveTableBuilder::buildEdgePermuteTable(
 // build table that performs specified twist on the edges
 // the permutation needed to rotate the cube to the new sym edge coordinate
 // is also returned.
-void MoveTableBuilder::buildEdgeTwistTable(Array2D<uint32_t> &edgeTwistTable) {
+void MoveTableBuilder::buildEdgeTwistTable(TwistTable &edgeTwistTable) {
   for (uint16_t position = 0; position < nSymEdgePositions; ++position) {
     for (uint16_t flip = 0; flip < nEdgeFlips; ++flip) {
 
@@ -279,8 +285,8 @@ void MoveTableBuilder::buildEdgeTwistTable(Array2D<uint32_t> &edgeTwistTable) {
         uint8_t permNeeded;
         EdgeCoordinate mjec = jem2jec(jem.move(twist), permNeeded);
 
-        edgeTwistTable(twist, eidx) =
-            (mjec.tableIndex() << nEdgePermBits) + permNeeded;
+        edgeTwistTable.set(twist, eidx,
+                           (mjec.tableIndex() << nEdgePermBits) + permNeeded);
       }
     }
   }
@@ -25,6 +25,13 @@ public:
   // constructs and returns the move table
   std::unique_ptr<MoveTable> build();
 
+  // constructs a move table whose sizes and home indices are set
+  // but whose tables are yet to be filled
+  std::unique_ptr<MoveTable> allocate() const;
+
+  // fills the tables of an allocated move table
+  void fill(MoveTable &moveTable);
+
 private:
   // builds the (temporary) rec2sec and sec2rec tables required
   // to build the move table
@@ -65,12 +72,12 @@ private:
 
   // Builds table that performs the specified twist for the
   // given symmetry.
-  void buildCornerTwistTable(Array2D<uint32_t> &cornerTwistTableX);
+  void buildCornerTwistTable(TwistTable &cornerTwistTableX);
 
   // Builds the table that performs the specified twist
   // on the edges.  it also holds the permutation required to
   // move the corners.
-  void buildEdgeTwistTable(Array2D<uint32_t> &edgeTwistTable);
+  void buildEdgeTwistTable(TwistTable &edgeTwistTable);
 
   // builds the table needed to permute the current symmetry
   void buildSymmetryPermuteTable(Array2D<uint8_t> &symmetryPermuteTable);
@@ -120,9 +127,8 @@ private:
   //   bit 1:  rotate a half-turn around z axis
   //   bit 0:  rotate a quarter-turn around z axis
   uint8_t selectNEdgePermBits() {
-    const uint8_t nEdgePermBitsA = 5;
-    const uint8_t nEdgePermBitsD = 4;
-    return options.enares.isEnabled() ? nEdgePermBitsA : nEdgePermBitsD;
+    return options.enares.isEnabled() ? MoveTable::nEdgePermBitsEnares
+                                      : MoveTable::nEdgePermBitsNaso;
   }
 
   const uint8_t nEdgePermBits;
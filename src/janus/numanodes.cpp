@@ -0,0 +1,170 @@
+// Copyright (C) 2022 Greg Dionne
+// Distributed under MIT License
+#include "numanodes.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Janus {
+
+#ifdef __linux__
+
+// memory policies and flags from <numaif.h>.
+// defined here to avoid a dependency upon libnuma
+static const int mpolBind = 2;
+static const int mpolInterleave = 3;
+static const unsigned mpolMfMove = 1 << 1;
+
+// parse a list such as "0-3,8-11" into its members
+static std::vector<int> parseList(const std::string &list) {
+  std::vector<int> members;
+  std::stringstream stream(list);
+  std::string range;
+  while (std::getline(stream, range, ',')) {
+    if (range.empty() || range == "\n") {
+      continue;
+    }
+    auto dash = range.find('-');
+    int first = std::stoi(range.substr(0, dash));
+    int last = dash == std::string::npos ? first
+                                         : std::stoi(range.substr(dash + 1));
+    for (int member = first; member <= last; ++member) {
+      members.push_back(member);
+    }
+  }
+  return members;
+}
+
+// read the first line of a sysfs file
+static std::string readLine(const std::string &filename) {
+  std::ifstream file(filename);
+  std::string line;
+  std::getline(file, line);
+  return line;
+}
+
+NumaNodes::NumaNodes() {
+  const std::string sysfs = "/sys/devices/system/node/";
+
+  for (int node : parseList(readLine(sysfs + "online"))) {
+    auto cpus = parseList(
+        readLine(sysfs + "node" + std::to_string(node) + "/cpulist"));
+
+    // ignore memory-only nodes
+    if (!cpus.empty()) {
+      nodeIds.push_back(static_cast<std::size_t>(node));
+      nodeCpus.push_back(cpus);
+    }
+  }
+}
+
+bool NumaNodes::bindThread(std::size_t node) const {
+  if (node >= size()) {
+    return false;
+  }
+
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  for (int cpu : nodeCpus[node]) {
+    CPU_SET(cpu, &cpuset);
+  }
+
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) == 0;
+}
+
+bool NumaNodes::interleave(void *addr, std::size_t length) const {
+  return applyPolicy(addr, length, mpolInterleave, nodeIds);
+}
+
+bool NumaNodes::bind(void *addr, std::size_t length, std::size_t node) const {
+  return node < size() && applyPolicy(addr, length, mpolBind, {nodeIds[node]});
+}
+
+bool NumaNodes::applyPolicy(void *addr, std::size_t length, int mode,
+                            const std::vector<std::size_t> &nodes) const {
+  if (nodes.empty()) {
+    return false;
+  }
+
+  // policies apply to whole pages
+  const auto pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  auto first = reinterpret_cast<uintptr_t>(addr);
+  auto last = first + length;
+  first = (first + pageSize - 1) & ~(pageSize - 1);
+  last = last & ~(pageSize - 1);
+  if (last <= first) {
+    return false;
+  }
+
+  const std::size_t bitsPerWord = 8 * sizeof(unsigned long);
+  std::size_t maxNode = 0;
+  for (auto node : nodes) {
+    maxNode = node > maxNode ? node : maxNode;
+  }
+
+  std::vector<unsigned long> mask(maxNode / bitsPerWord + 1);
+  for (auto node : nodes) {
+    mask[node / bitsPerWord] |= 1UL << (node % bitsPerWord);
+  }
+
+  return syscall(SYS_mbind, first, last - first, mode, mask.data(),
+                 mask.size() * bitsPerWord + 1, mpolMfMove) == 0;
+}
+
+std::size_t NumaNodes::availableMemory() {
+  // MemAvailable counts the page cache that could be reclaimed
+  std::ifstream meminfo("/proc/meminfo");
+  std::string line;
+  while (std::getline(meminfo, line)) {
+    std::size_t kB;
+    if (std::sscanf(line.c_str(), "MemAvailable: %zu kB", &kB) == 1) {
+      return kB * 1024;
+    }
+  }
+
+  // older kernels only report free memory
+  return static_cast<std::size_t>(sysconf(_SC_AVPHYS_PAGES)) *
+         static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+}
+
+#else
+
+// single (unknown) node
+NumaNodes::NumaNodes() : nodeIds(1), nodeCpus(1) {}
+
+bool NumaNodes::bindThread(std::size_t /*node*/) const { return false; }
+
+bool NumaNodes::interleave(void * /*addr*/, std::size_t /*length*/) const {
+  return false;
+}
+
+bool NumaNodes::bind(void * /*addr*/, std::size_t /*length*/,
+                     std::size_t /*node*/) const {
+  return false;
+}
+
+bool NumaNodes::applyPolicy(void * /*addr*/, std::size_t /*length*/,
+                            int /*mode*/,
+                            const std::vector<std::size_t> & /*nodes*/) const {
+  return false;
+}
+
+// unknown; callers find out when they allocate
+std::size_t NumaNodes::availableMemory() {
+  return std::numeric_limits<std::size_t>::max();
+}
+
+#endif
+
+} // namespace Janus
@@ -0,0 +1,52 @@
+// Copyright (C) 2022 Greg Dionne
+// Distributed under MIT License
+#ifndef JANUS_NUMANODES_HPP
+#define JANUS_NUMANODES_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace Janus {
+
+// The NUMA (non-uniform memory access) nodes of the host.
+//
+// On multi-socket hosts each socket has its own memory.  Reading
+// memory attached to another socket crosses the interconnect and
+// is considerably slower.
+//
+// Only Linux is supported; elsewhere a single node is reported
+// and placement requests are ignored.
+class NumaNodes {
+public:
+  // discovers the nodes of the host
+  NumaNodes();
+
+  // number of nodes with processors
+  std::size_t size() const { return nodeIds.size(); }
+
+  // pins the calling thread to the processors of the specified node
+  bool bindThread(std::size_t node) const;
+
+  // spreads the pages of the specified memory round-robin across
+  // all nodes.  Pages already touched are migrated.
+  bool interleave(void *addr, std::size_t length) const;
+
+  // places the pages of the specified memory on the specified node
+  bool bind(void *addr, std::size_t length, std::size_t node) const;
+
+  // bytes of memory currently available on the host (including
+  // reclaimable page cache).  unlimited when it can't be determined.
+  static std::size_t availableMemory();
+
+private:
+  // apply the specified memory policy to the specified nodes
+  bool applyPolicy(void *addr, std::size_t length, int mode,
+                   const std::vector<std::size_t> &nodes) const;
+
+  // system node ids and their processors
+  std::vector<std::size_t> nodeIds;
+  std::vector<std::vector<int>> nodeCpus;
+};
+
+} // namespace Janus
+#endif
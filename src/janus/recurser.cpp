@@ -14,124 +14,76 @@ bool RecurserFTM::leaf(const JanusCube &janusCube, uint8_t depth,
                        Solution &work, Solver *solver,
                        bool (Solver::*f)(const JanusCube &janusCube,
                                          uint8_t depth, Solution &work)) {
-
-  // fetch last move
-  uint8_t lastTwist = work.back();
-
-  // Expect failure
-  bool foundSolution = false;
-
-  // push a dummy value onto our temporary move list
-  work.push_back(0);
-
-  // for each move
-  for (uint8_t twist = 0; twist < nFaceTwists; ++twist) {
-
-    // if it's not the same face twisted previously and it's not
-    // a F, R or U twist immediately after a B, L or D twist, respectively
-    if (lastTwist % 6 != twist % 6 && lastTwist % 3 != twist % 6) {
-
-      foundSolution |= solver->recurseOne(janusCube, depth, work, twist, f);
-    }
-  }
-
-  // backtrack
-  work.pop_back();
-
-  return foundSolution;
+  return expand<false>(
+      work.back(), depth, work,
+      [&](const uint8_t *twists, uint8_t nTwists) {
+        return solver->recurseAll(janusCube, depth, work, twists, nTwists, f);
+      },
+      [](uint8_t) { return false; });
 }
 
 bool RecurserFTM::root(const JanusCube &janusCube, uint8_t depth,
                        Solution &work, Solver *solver,
                        bool (Solver::*f)(const JanusCube &janusCube,
                                          uint8_t depth, Solution &work)) {
-  // Expect failure
-  bool foundSolution = false;
-
-  // push a dummy value onto our temporary move list
-  work.push_back(0);
-
-  // for each move
-  for (uint8_t twist = 0; twist < nFaceTwists; ++twist) {
-
-    foundSolution |= solver->recurseOne(janusCube, depth, work, twist, f);
-  }
-
-  // backtrack
-  work.pop_back();
+  return expand<false>(
+      CanonicalTwists::start, depth, work,
+      [&](const uint8_t *twists, uint8_t nTwists) {
+        return solver->recurseAll(janusCube, depth, work, twists, nTwists, f);
+      },
+      [](uint8_t) { return false; });
+}
 
-  return foundSolution;
+uint8_t RecurserFTM::gather(const Solution &work, uint8_t depth,
+                           uint8_t *twists) const {
+  return CanonicalTwists::gather(
+      successors<false>(work.empty() ? CanonicalTwists::start : work.back(),
+                        depth),
+      twists);
 }
 
+uint8_t RecurserFTM::length(uint8_t) const { return 1; }
+
 bool RecurserQTM::leaf(const JanusCube &janusCube, uint8_t depth,
                        Solution &work, Solver *solver,
                        bool (Solver::*f)(const JanusCube &janusCube,
                                          uint8_t depth, Solution &work)) {
-  // fetch last move
-  uint8_t lastTwist = work.back();
-
-  // Expect failure
-  bool foundSolution = false;
-
-  // push a dummy value onto our temporary move list
-  work.push_back(0);
-
-  // for each quarter twist
-  for (uint8_t twist = 0; twist < nQuarterTwists; ++twist) {
-
-    // if it's not the same face twisted previously and it's not
-    // a F, R or U twist immediately after a B, L or D twist, respectively
-    if (lastTwist % 6 != twist % 6 && lastTwist % 3 != twist % 6) {
-
-      foundSolution |= solver->recurseOne(janusCube, depth, work, twist, f);
-    }
-  }
-
-  // for each half twist
-  if (depth > 1) {
-    for (uint8_t twist = nQuarterTwists; twist < nFaceTwists; ++twist) {
-
-      // if it's not the same face twisted previously and it's not
-      // a F, R or U twist immediately after a B, L or D twist, respectively
-      if (lastTwist % 6 != twist % 6 && lastTwist % 3 != twist % 6) {
-
-        foundSolution |= solver->recurseTwo(janusCube, depth, work, twist, f);
-      }
-    }
-  }
-
-  // backtrack
-  work.pop_back();
-
-  return foundSolution;
+  return expand<true>(
+      work.back(), depth, work,
+      [&](const uint8_t *twists, uint8_t nTwists) {
+        return solver->recurseAll(janusCube, depth, work, twists, nTwists, f);
+      },
+      [&](uint8_t twist) {
+        return solver->recurseTwo(janusCube, depth, work, twist, f);
+      });
 }
 
 bool RecurserQTM::root(const JanusCube &janusCube, uint8_t depth,
                        Solution &work, Solver *solver,
                        bool (Solver::*f)(const JanusCube &janusCube,
                                          uint8_t depth, Solution &work)) {
-  // Expect failure
-  bool foundSolution = false;
-
-  // push a dummy value onto our temporary move list
-  work.push_back(0);
-
-  // for each quarter twist
-  for (uint8_t twist = 0; twist < nQuarterTwists; ++twist) {
+  return expand<true>(
+      CanonicalTwists::start, depth, work,
+      [&](const uint8_t *twists, uint8_t nTwists) {
+        return solver->recurseAll(janusCube, depth, work, twists, nTwists, f);
+      },
+      [&](uint8_t twist) {
+        return solver->recurseTwo(janusCube, depth, work, twist, f);
+      });
+}
 
-    foundSolution |= solver->recurseOne(janusCube, depth, work, twist, f);
-  }
-  // for each half twist
-  if (depth > 1) {
-    for (uint8_t twist = nQuarterTwists; twist < nFaceTwists; ++twist) {
-      foundSolution |= solver->recurseTwo(janusCube, depth, work, twist, f);
-    }
-  }
+uint8_t RecurserQTM::gather(const Solution &work, uint8_t depth,
+                           uint8_t *twists) const {
 
-  // backtrack
-  work.pop_back();
+  // quarter twists, then half twists when there's room for them
+  return CanonicalTwists::gather(
+      successors<true>(work.empty() ? CanonicalTwists::start : work.back(),
+                       depth),
+      twists);
+}
 
-  return foundSolution;
+uint8_t RecurserQTM::length(uint8_t twist) const {
+  return twist < nQuarterTwists ? 1 : 2;
 }
 
 } // namespace Janus
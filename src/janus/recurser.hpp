@@ -3,6 +3,7 @@
 #ifndef JANUS_RECURSER_HPP
 #define JANUS_RECURSER_HPP
 
+#include "canonicaltwists.hpp"
 #include "clioptions.hpp"
 #include "cubedepth.hpp"
 #include "januscube.hpp"
@@ -29,6 +30,63 @@ public:
                     Solver *solver,
                     bool (Solver::*f)(const JanusCube &janusCube, uint8_t depth,
                                       Solution &work)) = 0;
+
+  // gathers the twists that may follow the last twist of the work
+  // (any twist at the root) with depth moves left, in the order leaf()
+  // and root() make them.  returns how many.
+  virtual uint8_t gather(const Solution &work, uint8_t depth,
+                         uint8_t *twists) const = 0;
+
+  // number of moves the specified twist counts as
+  virtual uint8_t length(uint8_t twist) const = 0;
+
+  // the twists that may follow the specified twist (or
+  // CanonicalTwists::start) with depth moves left, as a mask
+  template <bool qtm>
+  static uint32_t successors(uint8_t lastTwist, uint8_t depth) {
+    uint32_t twists = canonicalTwists.after(lastTwist);
+
+    // half twists count as two quarter twists
+    return qtm && depth <= 1 ? twists & CanonicalTwists::quarterTwists
+                             : twists;
+  }
+
+  // expands a position through each of its successors: the face (or
+  // quarter) twists together via batch(twists, nTwists), then, in the
+  // quarter-turn metric, each half twist via half(twist).  the work
+  // holds a dummy move for them to record their twist in.  returns
+  // true if either found a solution.
+  template <bool qtm, class Batch, class Half>
+  static bool expand(uint8_t lastTwist, uint8_t depth, Solution &work,
+                     Batch batch, Half half) {
+    uint32_t twists = successors<qtm>(lastTwist, depth);
+
+    // Expect failure
+    bool foundSolution = false;
+
+    // push a dummy value onto our temporary move list
+    work.push_back(0);
+
+    // for each face (or quarter) twist
+    uint8_t batchTwists[nFaceTwists];
+    uint8_t nTwists = CanonicalTwists::gather(
+        qtm ? twists & CanonicalTwists::quarterTwists : twists, batchTwists);
+    foundSolution |= batch(batchTwists, nTwists);
+
+    // for each half twist
+    if (qtm) {
+      for (uint32_t halves = twists & CanonicalTwists::halfTwists; halves;
+           halves &= halves - 1) {
+        foundSolution |= half(CanonicalTwists::first(halves));
+      }
+    }
+
+    // backtrack
+    work.pop_back();
+
+    return foundSolution;
+  }
+
   // utility creation
   static std::unique_ptr<Recurser> makeRecurser(const CLIOptions &options);
 };
@@ -46,6 +104,14 @@ public:
             Solver *solver,
             bool (Solver::*f)(const JanusCube &janusCube, uint8_t depth,
                               Solution &work)) final;
+
+  // gathers the twists that may follow the last twist of the work
+  // (any twist at the root) with depth moves left; returns how many
+  uint8_t gather(const Solution &work, uint8_t depth,
+                 uint8_t *twists) const final;
+
+  // number of moves the specified twist counts as
+  uint8_t length(uint8_t twist) const final;
 };
 
 class RecurserFTM : public Recurser {
@@ -61,6 +127,14 @@ public:
             Solver *solver,
             bool (Solver::*f)(const JanusCube &janusCube, uint8_t depth,
                               Solution &work)) final;
+
+  // gathers the twists that may follow the last twist of the work
+  // (any twist at the root) with depth moves left; returns how many
+  uint8_t gather(const Solution &work, uint8_t depth,
+                 uint8_t *twists) const final;
+
+  // number of moves the specified twist counts as
+  uint8_t length(uint8_t twist) const final;
 };
 
 } // namespace Janus
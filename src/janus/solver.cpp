@@ -70,7 +70,12 @@ uint8_t Solver::janusDepth(const Index &janus) const {
   std::size_t cidx = janus.corners;
   std::size_t eidx = janus.edges;
 
-  return depthTable->getDepth(cidx, eidx);
+  return depthTable->getLocalDepth(cidx, eidx);
+}
+
+// fetch the depth table entry for the specified janus index
+void Solver::prefetchJanusDepth(const Index &janus) const {
+  depthTable->prefetchLocalDepth(janus.corners, janus.edges);
 }
 
 // check the state of the cube index
@@ -111,20 +116,82 @@ bool Solver::recurseOne(const JanusCube &janusCube, uint8_t depth,
   return (this->*f)(trialCube, depth - 1, work);
 }
 
-bool Solver::recurseTwo(const JanusCube &janusCube, uint8_t depth,
-                        Solution &work, uint8_t twist,
-                        bool (Solver::*f)(const JanusCube &janusCube,
-                                          uint8_t depth, Solution &work)) {
+template <class Move, class Visit>
+bool Solver::recurseBatch(const JanusCube &janusCube, uint8_t depth,
+                          Solution &work, const uint8_t *twists,
+                          uint8_t nTwists, Move move, Visit visit) {
+  // make each trial move, and start fetching its depths
+  CubeIndex trialIndex[nFaceTwists];
+  for (uint8_t i = 0; i < nTwists; ++i) {
+    trialIndex[i] = move(janusCube.index, twists[i]);
+    prefetchJanusDepth(trialIndex[i].x);
+    prefetchJanusDepth(trialIndex[i].y);
+    prefetchJanusDepth(trialIndex[i].z);
+  }
+
+  // then look them all up before a deeper recursion evicts them
+  JanusCube trialCube[nFaceTwists];
+  for (uint8_t i = 0; i < nTwists; ++i) {
+    trialCube[i] = {trialIndex[i], redepth(janusCube.depth, trialIndex[i])};
+  }
+
+  bool foundSolution = false;
+  for (uint8_t i = 0; i < nTwists; ++i) {
+    // record the move
+    work.back() = twists[i];
+
+    foundSolution |= visit(trialCube[i], depth - 1);
+  }
+
+  return foundSolution;
+}
+
+template <class Move, class Visit>
+bool Solver::recurseHalf(const JanusCube &janusCube, uint8_t depth,
+                         Solution &work, uint8_t twist, Move move,
+                         Visit visit) {
   // record the move
   work.back() = twist;
 
   // make a temp cube with the first quarter turn
-  JanusCube tempCube = move(janusCube, twist - nQuarterTwists);
+  uint8_t quarter = twist - nQuarterTwists;
+  CubeIndex tempIndex = move(janusCube.index, quarter);
+  CubeDepth tempDepth = redepth(janusCube.depth, tempIndex);
 
   // make a trial cube with the second quarter turn
-  JanusCube trialCube = move(tempCube, twist - nQuarterTwists);
+  CubeIndex trialIndex = move(tempIndex, quarter);
+  JanusCube trialCube{trialIndex, redepth(tempDepth, trialIndex)};
 
-  return (this->*f)(trialCube, depth - 2, work);
+  return visit(trialCube, depth - 2);
+}
+
+bool Solver::recurseAll(const JanusCube &janusCube, uint8_t depth,
+                        Solution &work, const uint8_t *twists,
+                        uint8_t nTwists,
+                        bool (Solver::*f)(const JanusCube &janusCube,
+                                          uint8_t depth, Solution &work)) {
+  return recurseBatch(
+      janusCube, depth, work, twists, nTwists,
+      [this](const CubeIndex &index, uint8_t twist) {
+        return moveTable->move(index, twist);
+      },
+      [&](const JanusCube &trialCube, uint8_t trialDepth) {
+        return (this->*f)(trialCube, trialDepth, work);
+      });
+}
+
+bool Solver::recurseTwo(const JanusCube &janusCube, uint8_t depth,
+                        Solution &work, uint8_t twist,
+                        bool (Solver::*f)(const JanusCube &janusCube,
+                                          uint8_t depth, Solution &work)) {
+  return recurseHalf(
+      janusCube, depth, work, twist,
+      [this](const CubeIndex &index, uint8_t quarter) {
+        return moveTable->move(index, quarter);
+      },
+      [&](const JanusCube &trialCube, uint8_t trialDepth) {
+        return (this->*f)(trialCube, trialDepth, work);
+      });
 }
 
 // table solver.
@@ -136,6 +203,13 @@ bool Solver::recurseTwo(const JanusCube &janusCube, uint8_t depth,
 bool Solver::tableSolve(const JanusCube &janusCube, uint8_t depth,
                         Solution &work) {
 
+  return (this->*tableSolver)(janusCube, depth, work);
+}
+
+template <bool qtm, uint8_t nEdgePermBits>
+bool Solver::tableSolveKernel(const JanusCube &janusCube, uint8_t depth,
+                              Solution &work) {
+
   // leave if we can't satisfy the depth requirement
   if (janusCube.depth.tooFar(depth)) {
     return false;
@@ -146,7 +220,38 @@ bool Solver::tableSolve(const JanusCube &janusCube, uint8_t depth,
     return checkWork(janusCube.index, work);
   }
 
-  return recurser->leaf(janusCube, depth, work, this, &Solver::tableSolve);
+  // the moves (with the masks folded in) and the recursion are
+  // resolved when compiled
+  auto move = [this](const CubeIndex &index, uint8_t twist) {
+    return moveTable->move<nEdgePermBits>(index, twist);
+  };
+  auto visit = [&](const JanusCube &trialCube, uint8_t trialDepth) {
+    return tableSolveKernel<qtm, nEdgePermBits>(trialCube, trialDepth, work);
+  };
+
+  return Recurser::expand<qtm>(
+      work.back(), depth, work,
+      [&](const uint8_t *twists, uint8_t nTwists) {
+        return recurseBatch(janusCube, depth, work, twists, nTwists, move,
+                            visit);
+      },
+      [&](uint8_t twist) {
+        return recurseHalf(janusCube, depth, work, twist, move, visit);
+      });
+}
+
+Solver::SolveMethod
+Solver::selectTableSolver(const CLIOptions &options) const {
+  bool enares =
+      moveTable->getNEdgePermBits() == MoveTable::nEdgePermBitsEnares;
+  if (options.qtm.isEnabled()) {
+    return enares
+               ? &Solver::tableSolveKernel<true, MoveTable::nEdgePermBitsEnares>
+               : &Solver::tableSolveKernel<true, MoveTable::nEdgePermBitsNaso>;
+  }
+  return enares
+             ? &Solver::tableSolveKernel<false, MoveTable::nEdgePermBitsEnares>
+             : &Solver::tableSolveKernel<false, MoveTable::nEdgePermBitsNaso>;
 }
 
 // solve by trial and error...
@@ -172,7 +277,14 @@ bool Solver::trialSolve(const JanusCube &janusCube, uint8_t depth,
   return recurser->leaf(janusCube, depth, work, this, &Solver::trialSolve);
 }
 
-bool Solver::solveWorkList() {
+bool Solver::solveWorkList(std::size_t thread) {
+  // run on (and read the table local to) a NUMA node if requested
+  depthTable->bindThread(thread);
+
+  if (nStreams > 1) {
+    return solveWorkListStreams();
+  }
+
   bool found = false;
   WorkItem item;
   while (!canceling && worklist.pop(item)) {
@@ -181,6 +293,118 @@ bool Solver::solveWorkList() {
   return found && !canceling;
 }
 
+bool Solver::enterStream(SearchStream &stream, const JanusCube &janusCube,
+                         uint8_t depth) {
+
+  // within the table, prune as tableSolve does
+  if (depth < usefulDepth) {
+    if (janusCube.depth.tooFar(depth)) {
+      return false;
+    }
+    if (depth == 0) {
+      return checkWork(janusCube.index, stream.work);
+    }
+  } else if (canceling) {
+    return false;
+  }
+
+  if (stream.nFrames == stream.frames.size()) {
+    stream.frames.emplace_back();
+  }
+  SearchFrame &frame = stream.frames[stream.nFrames++];
+  frame.janusCube = janusCube;
+  frame.depth = depth;
+  frame.next = 0;
+  frame.nTwists = recurser->gather(stream.work, depth, frame.twists);
+
+  // make each trial move, and start fetching its depths
+  for (uint8_t i = 0; i < frame.nTwists; ++i) {
+    uint8_t twist = frame.twists[i];
+    if (recurser->length(twist) == 1) {
+      frame.trialIndex[i] = moveTable->move(janusCube.index, twist);
+    } else {
+      frame.halfIndex[i] =
+          moveTable->move(janusCube.index, twist - nQuarterTwists);
+      frame.trialIndex[i] =
+          moveTable->move(frame.halfIndex[i], twist - nQuarterTwists);
+      prefetchJanusDepth(frame.halfIndex[i].x);
+      prefetchJanusDepth(frame.halfIndex[i].y);
+      prefetchJanusDepth(frame.halfIndex[i].z);
+    }
+    prefetchJanusDepth(frame.trialIndex[i].x);
+    prefetchJanusDepth(frame.trialIndex[i].y);
+    prefetchJanusDepth(frame.trialIndex[i].z);
+  }
+
+  // push a dummy value onto our temporary move list
+  stream.work.push_back(0);
+  return false;
+}
+
+bool Solver::stepStream(SearchStream &stream, bool &foundSolution) {
+  if (stream.nFrames == 0) {
+    return false;
+  }
+
+  SearchFrame &frame = stream.frames[stream.nFrames - 1];
+
+  // backtrack
+  if (frame.next == frame.nTwists) {
+    stream.work.pop_back();
+    --stream.nFrames;
+    return stream.nFrames != 0;
+  }
+
+  // record the move
+  uint8_t i = frame.next++;
+  uint8_t twist = frame.twists[i];
+  stream.work.back() = twist;
+
+  // its depths were fetched when the frame was pushed
+  CubeDepth trialDepth = frame.janusCube.depth;
+  uint8_t length = recurser->length(twist);
+  if (length != 1) {
+    trialDepth = redepth(trialDepth, frame.halfIndex[i]);
+  }
+  trialDepth = redepth(trialDepth, frame.trialIndex[i]);
+
+  foundSolution |= enterStream(stream, {frame.trialIndex[i], trialDepth},
+                               frame.depth - length);
+  return stream.nFrames != 0;
+}
+
+bool Solver::solveWorkListStreams() {
+  std::vector<SearchStream> streams(nStreams);
+  std::vector<bool> busy(nStreams);
+  std::size_t nBusy = 0;
+  bool found = false;
+  bool drained = false;
+
+  // visit one position of each stream in turn, starting the next
+  // subtree of the work list whenever one is finished
+  do {
+    for (std::size_t s = 0; s < streams.size(); ++s) {
+      SearchStream &stream = streams[s];
+      if (busy[s]) {
+        busy[s] = stepStream(stream, found);
+        nBusy -= !busy[s];
+      } else if (!drained) {
+        WorkItem item;
+        if (canceling || !worklist.pop(item)) {
+          drained = true;
+        } else {
+          stream.work = std::move(item.work);
+          found |= enterStream(stream, item.janusCube, item.depth);
+          busy[s] = stream.nFrames != 0;
+          nBusy += busy[s];
+        }
+      }
+    }
+  } while (nBusy || !drained);
+
+  return found && !canceling;
+}
+
 bool Solver::makeWorkList(const JanusCube &janusCube, uint8_t depth,
                           Solution &work) {
 
@@ -217,8 +441,8 @@ bool Solver::rootThreadSolve(const JanusCube &janusCube, uint8_t depth,
 
   std::vector<std::future<bool>> results(nRootThreads());
 
-  for (auto &result : results) {
-    result = std::async(&Solver::solveWorkList, this);
+  for (std::size_t thread = 0; thread < results.size(); ++thread) {
+    results[thread] = std::async(&Solver::solveWorkList, this, thread);
   }
 
   bool foundSolution = false;
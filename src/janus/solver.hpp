@@ -11,8 +11,11 @@
 #include "recurser.hpp"
 #include "worklist.hpp"
 
+#include <algorithm>
 #include <cstdint>
+#include <cstdlib>
 #include <functional>
+#include <future>
 #include <memory>
 #include <mutex>
 #include <thread>
@@ -23,15 +26,21 @@ namespace Janus {
 class Solver {
 public:
   Solver(const CLIOptions &options, const MoveTable *jmt,
+         std::shared_future<void> moveTableBuilt,
          std::function<void(const std::string &)> console,
-         std::function<bool(uint8_t *, std::size_t)> load,
-         std::function<bool(const uint8_t *, std::size_t)> save)
+         const std::string &filename,
+         std::function<bool(uint8_t *, std::size_t, std::size_t)> load,
+         std::function<bool(const uint8_t *, std::size_t, std::size_t)>
+             save)
       : moveTable(jmt), depthTable(std::make_unique<DepthTable>(
-                            options, jmt, console, load, save)),
+                            options, jmt, std::move(moveTableBuilt), console,
+                            filename, load, save)),
         recurser(Recurser::makeRecurser(options)),
         GodsNumber(selectGodsNumber(options)),
         usefulDepth(selectUsefulDepth(options)),
         depthIncrement(selectDepthIncrement(options)),
+        tableSolver(selectTableSolver(options)),
+        nStreams(selectNStreams(options)),
         homeCornerIndex(jmt->getHomeCornerIndex()),
         homeEdgeIndex(jmt->getHomeEdgeIndex()),
         homeCubeIndex({{homeCornerIndex, homeEdgeIndex, 32},
@@ -62,6 +71,31 @@ public:
                   bool (Solver::*f)(const JanusCube &janusCube, uint8_t depth,
                                     Solution &work));
 
+  // perform each of the specified twists through move(index, twist),
+  // passing each position reached to visit(janusCube, depth).  The
+  // moves are all made and their depth table entries fetched together
+  // before visiting any of them, so that the table reads overlap.
+  template <class Move, class Visit>
+  bool recurseBatch(const JanusCube &janusCube, uint8_t depth, Solution &work,
+                    const uint8_t *twists, uint8_t nTwists, Move move,
+                    Visit visit);
+
+  // perform each of the specified moves.  The moves are all made and
+  // their depth table entries fetched together before recursing into
+  // any of them, so that the table reads overlap.
+  bool recurseAll(const JanusCube &janusCube, uint8_t depth, Solution &work,
+                  const uint8_t *twists, uint8_t nTwists,
+                  bool (Solver::*f)(const JanusCube &janusCube, uint8_t depth,
+                                    Solution &work));
+
+  // perform a half-twist counting each one twice...
+  // (the twist is made through move(index, quarter) and the position
+  // it reaches is passed to visit(janusCube, depth), as with
+  // recurseBatch)
+  template <class Move, class Visit>
+  bool recurseHalf(const JanusCube &janusCube, uint8_t depth, Solution &work,
+                   uint8_t twist, Move move, Visit visit);
+
   // perform a half-twist counting each one twice...
   bool recurseTwo(const JanusCube &janusCube, uint8_t depth, Solution &work,
                   uint8_t twist,
@@ -84,6 +118,10 @@ private:
   // the specified Janus coordinate from the depth table
   uint8_t janusDepth(const Index &janus) const;
 
+  // hints that the depth of the specified Janus coordinate will soon
+  // be retrieved
+  void prefetchJanusDepth(const Index &janus) const;
+
   // check the state of the cube index
   // if solved, commit the solution and invoke any user callback
   bool checkWork(const CubeIndex &cIndex, Solution &work);
@@ -101,6 +139,13 @@ private:
   // 4.  calls itself with the new move and decremented depth.
   bool tableSolve(const JanusCube &janusCube, uint8_t depth, Solution &work);
 
+  // tableSolve compiled for a metric and edge permutation width, so
+  // that it recurses into itself directly and moves with the masks
+  // folded into constants
+  template <bool qtm, uint8_t nEdgePermBits>
+  bool tableSolveKernel(const JanusCube &janusCube, uint8_t depth,
+                        Solution &work);
+
   // checks to see if it can be solved via the table, and calls
   // tableSolve if so.
   // otherwise it
@@ -112,8 +157,44 @@ private:
   // 4.  calls itself with the new move and decremented depth.
   bool trialSolve(const JanusCube &janusCube, uint8_t depth, Solution &work);
 
-  // solve the work list
-  bool solveWorkList();
+  // solve the work list (on the specified thread)
+  bool solveWorkList(std::size_t thread);
+
+  // a position of an explicit-stack search, with the twists to try
+  // from it and the positions they lead to
+  struct SearchFrame {
+    JanusCube janusCube;
+    uint8_t depth;
+    uint8_t nTwists;
+    uint8_t next;
+    uint8_t twists[nFaceTwists];
+
+    // the position after each twist and, for twists that count as
+    // two moves, after its first quarter
+    CubeIndex trialIndex[nFaceTwists];
+    CubeIndex halfIndex[nFaceTwists];
+  };
+
+  // a subtree of the work list being searched without recursion
+  struct SearchStream {
+    std::vector<SearchFrame> frames;
+    std::size_t nFrames = 0;
+    Solution work;
+  };
+
+  // enter a position of a stream's search as tableSolve or trialSolve
+  // would, pushing a frame (and fetching its children's depths) if
+  // there are twists to try from it.
+  bool enterStream(SearchStream &stream, const JanusCube &janusCube,
+                   uint8_t depth);
+
+  // try the next twist of the stream's top frame, or pop the frame
+  // if there are none left.  returns false once the stream is empty.
+  bool stepStream(SearchStream &stream, bool &foundSolution);
+
+  // solve the work list as solveWorkList would, but interleaving
+  // several subtrees so that one's table reads overlap the others'
+  bool solveWorkListStreams();
 
   // Make the work list, adding to it when at the specified depth
   bool makeWorkList(const JanusCube &janusCube, uint8_t depth, Solution &work);
@@ -172,6 +253,24 @@ private:
     return options.qtm.isEnabled() ? depthIncrementQTM : depthIncrementFTM;
   }
 
+  // the tableSolveKernel for the metric and table
+  typedef bool (Solver::*SolveMethod)(const JanusCube &janusCube,
+                                      uint8_t depth, Solution &work);
+  const SolveMethod tableSolver;
+  SolveMethod selectTableSolver(const CLIOptions &options) const;
+
+  // number of subtrees each solver thread searches at once
+  const std::size_t nStreams;
+  std::size_t selectNStreams(const CLIOptions &options) {
+    // keeps the frames of every stream of a thread in its caches
+    const unsigned long nMaxStreams = 32;
+
+    unsigned long n = options.streams.isSet()
+                          ? std::strtoul(options.streams.c_str(), nullptr, 10)
+                          : 1;
+    return std::min(std::max(n, 1UL), nMaxStreams);
+  }
+
   // number of threads to use if std::thread::hardware_concurrency() returns 0
   constexpr static uint8_t nDefaultThreads = 18;
 
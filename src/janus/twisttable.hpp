@@ -0,0 +1,76 @@
+// Copyright (C) 2022 Greg Dionne
+// Distributed under MIT License
+#ifndef JANUS_TWISTTABLE_HPP
+#define JANUS_TWISTTABLE_HPP
+
+#include "constants.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace Janus {
+
+// Table of the coordinate reached by each face twist of each
+// coordinate, laid out coordinate-major.
+//
+// A node of the search twists each Janus every way at once, so all
+// the twists of a coordinate are kept together in a single 64-byte
+// row, aligned to a cache line.  To fit, each entry is packed into
+// three bytes, which holds any corner index (18 bits) or edge value
+// (edge index and permutation, at most 24 bits).
+//
+// Something like:
+//
+//   TwistTable table(nCoords);
+//   table.set(twist, coord, value);
+//   uint32_t value = table(twist, coord);
+//
+class TwistTable {
+public:
+  explicit TwistTable(std::size_t nCoords)
+      : v(nCoords * rowBytes + lineBytes - 1),
+        rows(v.data() + (-reinterpret_cast<uintptr_t>(v.data()) &
+                         (lineBytes - 1))) {}
+
+  // no reason to move/copy yet.
+  TwistTable() = delete;
+  TwistTable(const TwistTable &) = delete;
+  TwistTable(TwistTable &&) = delete;
+  TwistTable &operator=(const TwistTable &) = delete;
+  TwistTable &operator=(TwistTable &&) = delete;
+
+  ~TwistTable() = default;
+
+  // the value reached by the twist of the coordinate
+  uint32_t operator()(std::size_t twist, std::size_t coord) const {
+    // the last entry leaves room in its row to read a whole word.
+    // assumes a little-endian host, as the table files do
+    uint32_t value;
+    std::memcpy(&value, rows + coord * rowBytes + twist * entryBytes,
+                sizeof(value));
+    return value & entryMask;
+  }
+
+  void set(std::size_t twist, std::size_t coord, uint32_t value) {
+    uint8_t *entry = rows + coord * rowBytes + twist * entryBytes;
+    for (std::size_t i = 0; i < entryBytes; ++i) {
+      entry[i] = static_cast<uint8_t>(value >> (i * 8));
+    }
+  }
+
+private:
+  static constexpr std::size_t entryBytes = 3;
+  static constexpr uint32_t entryMask = 0xffffff;
+  static constexpr std::size_t lineBytes = 64;
+  static constexpr std::size_t rowBytes = lineBytes;
+  static_assert(nFaceTwists * entryBytes + sizeof(uint32_t) - entryBytes <=
+                    rowBytes,
+                "every twist of a coordinate must share its row");
+
+  std::vector<uint8_t> v;
+  uint8_t *rows;
+};
+
+} // namespace Janus
+#endif
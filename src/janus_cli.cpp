@@ -76,7 +76,8 @@ int main(int argc, char *argv[]) {
     return 1;
   }
 
-  Janus::Cube cube(options, &console, &loadFile, &saveFile);
+  Janus::Cube cube(options, &console, depthTableFilename(), &loadFile,
+                   &saveFile);
 
   if (arguments.size() == 1) {
 
@@ -1,12 +1,18 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <memory>
 #include <numeric>
 #include <string>
+#include <vector>
 
 #include "janus/strutils.hpp"
 #include "janus_core.hpp"
+#include "utils/compressedfile.hpp"
+#include "utils/stripedfile.hpp"
 
 Janus::CLIOptions options;
 
@@ -14,7 +20,7 @@ static const char *moveString[] = {"F",  "R",  "U",  "B",  "L",  "D",
                                    "F'", "R'", "U'", "B'", "L'", "D'",
                                    "F2", "R2", "U2", "B2", "L2", "D2"};
 
-static std::string depthTableFilename() {
+std::string depthTableFilename() {
   std::string filename("depthTable-");
   filename += options.qtm.isEnabled() ? "QTM" : "FTM";
   filename += options.enares.isEnabled() ? "-enares" : "";
@@ -22,30 +28,187 @@ static std::string depthTableFilename() {
   return filename;
 }
 
-bool loadFile(uint8_t *data, std::size_t nBytes) {
-
+// the saved table, possibly striped across several directories
+static utils::StripedFile depthTableFile() {
   auto filename = depthTableFilename();
 
-  std::FILE *fp = std::fopen(filename.c_str(), "rb");
+  std::vector<std::string> dirs;
+  std::string list = options.stripe.c_str() ? options.stripe.c_str() : "";
+  for (std::size_t pos = 0; pos < list.size();) {
+    auto comma = std::min(list.find(',', pos), list.size());
+    if (comma > pos) {
+      dirs.push_back(list.substr(pos, comma - pos));
+    }
+    pos = comma + 1;
+  }
 
-  if (fp == NULL) {
-    // failed to open
-    std::perror(filename.c_str());
+  std::vector<std::string> paths;
+  if (dirs.empty()) {
+    paths.push_back(filename);
+  }
+  for (std::size_t i = 0; i < dirs.size(); ++i) {
+    paths.push_back(dirs[i] + "/" + filename + "." + std::to_string(i + 1) +
+                    "-of-" + std::to_string(dirs.size()));
+  }
+
+  return utils::StripedFile(paths, options.direct.isEnabled());
+}
+
+// the transfer in progress, if any, for tableStatus()
+static std::atomic<const char *> transferActivity{nullptr};
+static std::atomic<std::size_t> transferDone{0};
+static std::atomic<std::size_t> transferTotal{0};
+
+// reports progress in steps of ten percent
+class TransferProgress {
+public:
+  TransferProgress(const char *activity, std::size_t n)
+      : nBytes(n), start(std::chrono::steady_clock::now()) {
+    transferDone = 0;
+    transferTotal = n;
+    transferActivity = activity;
+  }
+
+  ~TransferProgress() { transferActivity = nullptr; }
+
+  TransferProgress(const TransferProgress &) = delete;
+  TransferProgress &operator=(const TransferProgress &) = delete;
+
+  void operator()(std::size_t nDone) {
+    transferDone = nDone;
+    std::size_t percent = nBytes ? nDone * 100 / nBytes : 100;
+    while (reported + 10 <= percent && reported < 90) {
+      reported += 10;
+      fprintf(stderr, "%zu%%... ", reported);
+      fflush(stderr);
+    }
+  }
+
+  // throughput in MB/s
+  std::string rate(std::size_t nDone) const {
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    double seconds = elapsed.count() > 0 ? elapsed.count() : 1e-9;
+    return Janus::to_commastring(
+        static_cast<std::size_t>(nDone / seconds / 1000000), 0);
+  }
+
+private:
+  const std::size_t nBytes;
+  const std::chrono::steady_clock::time_point start;
+  std::size_t reported = 0;
+};
+
+static std::string describe(const utils::StripedFile &file) {
+  const auto &paths = file.getPaths();
+  return paths.size() == 1 ? paths[0]
+                           : paths[0] + " (+" +
+                                 std::to_string(paths.size() - 1) +
+                                 " more stripes)";
+}
+
+// ratio of compressed to uncompressed size
+static std::string ratio(std::size_t nCompressed, std::size_t nBytes) {
+  return std::to_string(nBytes ? nCompressed * 100 / nBytes : 0) + "%";
+}
+
+static bool loadCompressed(const utils::CompressedFile &file, uint8_t *data,
+                           std::size_t nBytes) {
+
+  fprintf(stderr, "decompressing %s... ", file.getPath().c_str());
+  fflush(stderr);
+
+  TransferProgress progress("decompressing", nBytes);
+  std::size_t result =
+      file.read(data, nBytes, [&](std::size_t n) { progress(n); });
+
+  fprintf(stderr, "%s bytes decompressed (%s MB/s)\n",
+          Janus::to_commastring(result, 14).c_str(),
+          progress.rate(result).c_str());
+
+  if (result != nBytes) {
+    fprintf(stderr, "%s is incomplete, corrupt or for a different table\n",
+            file.getPath().c_str());
+    fprintf(stderr, "expected: %s\n",
+            Janus::to_commastring(nBytes, 14).c_str());
     return false;
   }
 
-  fprintf(stderr, "reading %s... ", filename.c_str());
+  return true;
+}
+
+static bool saveCompressed(const utils::CompressedFile &file,
+                           const uint8_t *data, std::size_t nBytes) {
+
+  fprintf(stderr, "compressing %s... ", file.getPath().c_str());
   fflush(stderr);
 
+  TransferProgress progress("compressing", nBytes);
+  std::size_t result =
+      file.write(data, nBytes, [&](std::size_t n) { progress(n); });
+
+  fprintf(stderr, "%s bytes compressed to %s (%s MB/s)\n",
+          Janus::to_commastring(result, 14).c_str(),
+          ratio(file.compressedSize(), result).c_str(),
+          progress.rate(result).c_str());
+
+  if (result != nBytes) {
+    std::perror(file.getPath().c_str());
+    if (std::remove(file.getPath().c_str())) {
+      fprintf(stderr, "Couldn't remove incomplete file\n");
+    }
+    return false;
+  }
+
+  return true;
+}
+
+// only transfers of at least a chunk (i.e. the table rather than its
+// header) are reported
+static bool isReported(std::size_t nBytes) {
+  return nBytes >= utils::StripedFile::chunkSize;
+}
+
+bool loadFile(uint8_t *data, std::size_t nBytes, std::size_t offset) {
+
+  // compressed tables are recognized by their contents
+  utils::CompressedFile compressed(depthTableFilename(), offset);
+  if (offset && !options.stripe.isSet() && compressed.isCompressed()) {
+    return loadCompressed(compressed, data, nBytes);
+  }
+
+  auto file = depthTableFile();
+
+  if (file.size() == 0) {
+    // failed to open
+    std::perror(file.failedPath().empty() ? describe(file).c_str()
+                                          : file.failedPath().c_str());
+    return false;
+  }
+
+  bool reported = isReported(nBytes);
+  if (reported) {
+    fprintf(stderr, "reading %s... ", describe(file).c_str());
+    fflush(stderr);
+  }
+
   // try reading it
-  std::size_t result = std::fread(data, 1, nBytes, fp);
-  fclose(fp);
+  TransferProgress progress("reading", nBytes);
+  std::size_t result = file.read(data, nBytes, offset, [&](std::size_t n) {
+    if (reported) {
+      progress(n);
+    }
+  });
 
-  fprintf(stderr, "%s bytes read\n", Janus::to_commastring(result, 14).c_str());
+  if (reported) {
+    fprintf(stderr, "%s bytes read (%s MB/s)\n",
+            Janus::to_commastring(result, 14).c_str(),
+            progress.rate(result).c_str());
+  }
 
   if (result != nBytes) {
     fprintf(stderr, "incorrect number of bytes read from %s\n",
-            filename.c_str());
+            file.failedPath().c_str());
     fprintf(stderr, "expected: %s\n",
             Janus::to_commastring(nBytes, 14).c_str());
     return false;
@@ -54,35 +217,54 @@ bool loadFile(uint8_t *data, std::size_t nBytes) {
   return true;
 }
 
-bool saveFile(const uint8_t *data, std::size_t nBytes) {
+bool saveFile(const uint8_t *data, std::size_t nBytes, std::size_t offset) {
 
-  auto filename = depthTableFilename();
+  // a compressed table follows its header in a single file
+  if (options.compress.isEnabled() && offset) {
+    return saveCompressed(
+        utils::CompressedFile(depthTableFilename(), offset), data, nBytes);
+  }
 
-  std::FILE *fp = std::fopen(filename.c_str(), "wb");
+  auto file = options.compress.isEnabled()
+                  ? utils::StripedFile({depthTableFilename()})
+                  : depthTableFile();
 
-  if (fp == NULL) {
-    std::perror(filename.c_str());
-    return false;
+  bool reported = isReported(nBytes);
+  if (reported) {
+    fprintf(stderr, "writing %s... ", describe(file).c_str());
+    fflush(stderr);
   }
 
-  fprintf(stderr, "writing %s... ", filename.c_str());
-  fflush(stderr);
+  TransferProgress progress("writing", nBytes);
+  std::size_t result = file.write(data, nBytes, offset, [&](std::size_t n) {
+    if (reported) {
+      progress(n);
+    }
+  });
 
-  std::size_t result = std::fwrite(data, 1, nBytes, fp);
-  fclose(fp);
+  if (result == 0 && !file.failedPath().empty()) {
+    if (reported) {
+      fprintf(stderr, "\n");
+    }
+    std::perror(file.failedPath().c_str());
+    return false;
+  }
 
-  fprintf(stderr, "%s bytes written\n",
-          Janus::to_commastring(result, 14).c_str());
+  if (reported) {
+    fprintf(stderr, "%s bytes written (%s MB/s)\n",
+            Janus::to_commastring(result, 14).c_str(),
+            progress.rate(result).c_str());
+  }
 
   // handle if write failed
   if (result != nBytes) {
     fprintf(stderr, "incorrect number of bytes written to %s\n",
-            filename.c_str());
+            file.failedPath().c_str());
     fprintf(stderr, "%s bytes expected ",
             Janus::to_commastring(nBytes, 14).c_str());
-    if (std::remove(filename.c_str())) {
+    if (!file.remove()) {
       fprintf(stderr, "Couldn't remove incomplete file\n");
-      perror(filename.c_str());
+      perror(file.failedPath().c_str());
     }
     return false;
   }
@@ -90,6 +272,18 @@ bool saveFile(const uint8_t *data, std::size_t nBytes) {
   return true;
 }
 
+std::string tableStatus() {
+  const char *activity = transferActivity;
+  if (activity == nullptr) {
+    return "preparing depth table";
+  }
+
+  std::size_t nBytes = transferTotal;
+  std::size_t percent = nBytes ? transferDone * 100 / nBytes : 100;
+  return std::string(activity) + " depth table (" + std::to_string(percent) +
+         "%)";
+}
+
 static void printDepth(std::size_t depth) {
   console("searching depth " + std::to_string(depth) + "...\n");
 }
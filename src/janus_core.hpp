@@ -2,10 +2,16 @@
 
 // provided by core
 extern Janus::CLIOptions options;
-extern bool loadFile(uint8_t *data, std::size_t nBytes);
-extern bool saveFile(const uint8_t *data, std::size_t nBytes);
+extern std::string depthTableFilename();
+extern bool loadFile(uint8_t *data, std::size_t nBytes, std::size_t offset);
+extern bool saveFile(const uint8_t *data, std::size_t nBytes,
+                     std::size_t offset);
 extern bool solveScramble(const char *moves, Janus::Cube &cube, bool async);
 
+// describes what is keeping the depth table from being ready.
+// may be called from any thread.
+extern std::string tableStatus();
+
 // client must implement
 extern void console(const std::string &message);
 extern void consoleOut(const std::string &message);
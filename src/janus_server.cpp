@@ -3,10 +3,13 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <exception>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <numeric>
 #include <string>
+#include <thread>
 
 #include "janus/cube.hpp"
 #include "janus/strutils.hpp"
@@ -46,8 +49,8 @@ void unrecognized(char *str) {
 void cmdMetric(bool qtm) { console(qtm ? "quater-turn\n" : "face-turn\n"); }
 
 static const char *const cmdList[] = {
-    "valid commands are \"help\", \"metric\", \"abort\", \"solve\", or "
-    "\"exit\".\n\n",
+    "valid commands are \"help\", \"metric\", \"status\", \"abort\", "
+    "\"solve\", or \"exit\".\n\n",
     "  help\n",
     "    prints this help message\n\n",
     "  metric\n",
@@ -55,10 +58,15 @@ static const char *const cmdList[] = {
     "    The quater-turn metric can be invoked via the \"-q\" option "
     "switch\n",
     "    when starting the server from the command line.\n\n",
+    "  status\n",
+    "    reports whether the depth table is ready and, if not, how\n",
+    "    far along loading it is.\n\n",
     "  abort\n",
     "    stops any solution in progress.\n\n",
     "  solve  <moves>\n",
     "    prints all minimal solutions using the current metric\n",
+    "    If the depth table is still loading, the scramble is queued\n",
+    "    and solved as soon as the table is ready.\n",
     "    valid moves are entered in Singmaster notation:\n",
     "      F  R  U  B  L  D  (clockwise moves)\n",
     "      F' R' U' B' L' D' (counter-clockwise moves)\n",
@@ -78,10 +86,60 @@ void cmdHelp() {
   }
 }
 
-void cmdAbort(Janus::Cube &cube) { cube.reset(); }
+// the cube becomes available once its tables are loaded.
+// until then, the latest scramble to solve is kept in pendingMoves.
+// Like a solve in progress, it is replaced by a new scramble and
+// dropped when aborted.
+static std::mutex cubeMutex;
+static std::unique_ptr<Janus::Cube> cube;
+static std::string pendingMoves;
 
-void cmdSolve(char *moves, Janus::Cube &cube) {
-  solveScramble(moves, cube, true);
+void loadCube() {
+  std::unique_ptr<Janus::Cube> loaded;
+  try {
+    loaded = std::make_unique<Janus::Cube>(
+        options, &consoleStr, depthTableFilename(), &loadFile, &saveFile);
+  } catch (const std::exception &e) {
+    console(std::string("couldn't initialize: ") + e.what() + "\n");
+    std::exit(EXIT_FAILURE);
+  }
+
+  std::lock_guard<std::mutex> lock(cubeMutex);
+  cube = std::move(loaded);
+  console("depth table ready\n");
+  if (!pendingMoves.empty()) {
+    solveScramble(pendingMoves.c_str(), *cube, true);
+    pendingMoves.clear();
+  }
+}
+
+void cmdStatus() {
+  std::lock_guard<std::mutex> lock(cubeMutex);
+  if (cube) {
+    console("depth table ready\n");
+  } else {
+    console(tableStatus());
+    console(pendingMoves.empty() ? "\n" : "; solve queued\n");
+  }
+}
+
+void cmdAbort() {
+  std::lock_guard<std::mutex> lock(cubeMutex);
+  if (cube) {
+    cube->reset();
+  } else {
+    pendingMoves.clear();
+  }
+}
+
+void cmdSolve(char *moves) {
+  std::lock_guard<std::mutex> lock(cubeMutex);
+  if (cube) {
+    solveScramble(moves, *cube, true);
+  } else {
+    pendingMoves = moves;
+    console("depth table still loading; solve queued\n");
+  }
 }
 
 void prompt() { console("ready\n"); }
@@ -169,11 +227,13 @@ int main(int argc, char *argv[]) {
     return 1;
   }
 
+  // accept connections while the tables load
   printf("Initializing...\n");
-  Janus::Cube cube(options, &consoleStr, &loadFile, &saveFile);
+  std::thread loader(loadCube);
+  loader.detach();
 
-  createServer(arguments[0], [&cube]() -> void {
-    cube.reset();
+  createServer(arguments[0], []() -> void {
+    cmdAbort();
 
     prompt();
 
@@ -189,10 +249,12 @@ int main(int argc, char *argv[]) {
           cmdHelp();
         } else if (!strncmp(buf, "metric", 6)) {
           cmdMetric(options.qtm.isEnabled());
+        } else if (!strncmp(buf, "status", 6)) {
+          cmdStatus();
         } else if (!strncmp(buf, "abort", 5)) {
-          cmdAbort(cube);
+          cmdAbort();
         } else if (!strncmp(buf, "solve", 5)) {
-          cmdSolve(buf + 6, cube);
+          cmdSolve(buf + 6);
         } else if (!strncmp(buf, "exit", 4)) {
           break;
         } else if (n > 0) {
@@ -22,9 +22,14 @@
 #include <unistd.h>
 
 #include <functional>
+#include <mutex>
 
-// active client
-static int clientSocket = 0;
+// active client (-1 when there is none).  it is only changed by the
+// accepting thread, but other threads may write to it, so changes
+// and writes are made under the mutex.  errors only shut the socket
+// down, so it stays open (and its fd unused) until closeSocket().
+static int clientSocket = -1;
+static std::mutex clientMutex;
 
 // number of queued connections to make
 static const int backlog = 10;
@@ -114,12 +119,16 @@ int createServer(const char *port, std::function<void()> callback) {
   while (1) { // main accept() loop
     printf("server: waiting for connection...\n");
     sin_size = sizeof their_addr;
-    clientSocket =
+    int newSocket =
         accept(listenSocket, (struct sockaddr *)&their_addr, &sin_size);
-    if (clientSocket == -1) {
+    if (newSocket == -1) {
       perror("accept");
       continue;
     }
+    {
+      std::lock_guard<std::mutex> lock(clientMutex);
+      clientSocket = newSocket;
+    }
 
     inet_ntop(their_addr.ss_family, get_in_addr((struct sockaddr *)&their_addr),
               s, sizeof s);
@@ -136,20 +145,31 @@ int readSocket(char *recvbuf, int recvbuflen) {
   ssize_t n = read(clientSocket, recvbuf, recvbuflen);
   if (n < 0) {
     perror("socket: read");
-    close(clientSocket);
+    shutdown(clientSocket, SHUT_RDWR);
   }
   return n;
 }
 
 int writeSocket(const char *sendbuf, int sendbuflen) {
+  std::lock_guard<std::mutex> lock(clientMutex);
+
+  // nobody to tell (e.g. while loading before the first connection)
+  if (clientSocket < 0) {
+    return 0;
+  }
+
   ssize_t n = write(clientSocket, sendbuf, sendbuflen);
   if (n < 0) {
     perror("socket: write");
-    close(clientSocket);
+    shutdown(clientSocket, SHUT_RDWR);
   }
   return n;
 }
 
-void closeSocket() { close(clientSocket); }
+void closeSocket() {
+  std::lock_guard<std::mutex> lock(clientMutex);
+  close(clientSocket);
+  clientSocket = -1;
+}
 
 #endif
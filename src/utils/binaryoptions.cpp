@@ -37,6 +37,17 @@ void BinaryOptions::usage(const char *progname,
     n += fprintf(stderr, "]");
   }
 
+  for (const auto &option : valueTable) {
+    if (n > nWrap) {
+      fprintf(stderr, "\n");
+      n = fprintf(stderr, "%7s", "");
+      for (size_t i = 0; i < strlen(progname); ++i) {
+        n += fprintf(stderr, " ");
+      }
+    }
+    n += fprintf(stderr, " [-%s=<%s>]", option->name(), option->meta());
+  }
+
   fprintf(stderr, "\n%7s", "");
   for (size_t i = 0; i < strlen(progname); ++i) {
     fprintf(stderr, " ");
@@ -56,15 +67,28 @@ void BinaryOptions::helpOptionSummary(const BinaryOption *option) {
   fprintf(stderr, "\n");
 }
 
+void BinaryOptions::helpOptionSummary(const ValueOption *option) {
+  std::string nameValue =
+      std::string(option->name()) + "=<" + option->meta() + ">";
+  fprintf(stderr, " -%-12s %s\n", nameValue.c_str(), option->summary());
+  if (option->isSet()) {
+    fprintf(stderr, "  %-12s (default: %s)\n", "", option->c_str());
+  }
+  fprintf(stderr, "\n");
+}
+
 void BinaryOptions::helpOptions() const {
   fprintf(stderr, "OPTIONS\n\n");
   for (const auto &option : table) {
     helpOptionSummary(option);
   }
+  for (const auto &option : valueTable) {
+    helpOptionSummary(option);
+  }
 }
 
-void BinaryOptions::helpOptionDetails(const BinaryOption *option) const {
-  const char *text = option->details();
+void BinaryOptions::helpOptionDetails(const char *details) const {
+  const char *text = details;
 
   do {
     int n = 0;
@@ -97,7 +121,16 @@ void BinaryOptions::helpTopic(const char *progname, const char *target) const {
         (!strcmp(option->onSwitch(), target) ||
          (option->offSwitch() && !strcmp(option->offSwitch(), target)))) {
       helpOptionSummary(option);
-      helpOptionDetails(option);
+      helpOptionDetails(option->details());
+
+      return;
+    }
+  }
+
+  for (const auto &option : valueTable) {
+    if (!strcmp(option->name(), target)) {
+      helpOptionSummary(option);
+      helpOptionDetails(option->details());
 
       return;
     }
@@ -136,6 +169,18 @@ BinaryOption *BinaryOptions::findOffSwitch(const char *arg) {
   return op == table.end() ? nullptr : *op;
 }
 
+// matches "-name=value"
+ValueOption *BinaryOptions::findValueOption(const char *arg) {
+  auto op = std::find_if(
+      valueTable.begin(), valueTable.end(), [&arg](const ValueOption *o) {
+        std::size_t len = strlen(o->name());
+        return arg && arg[0] && !strncmp(arg + 1, o->name(), len) &&
+               arg[len + 1] == '=';
+      });
+
+  return op == valueTable.end() ? nullptr : *op;
+}
+
 std::vector<const char *>
 BinaryOptions::parse(int argc, const char *const argv[],
                      const std::function<void()> &argUsage,
@@ -171,6 +216,8 @@ BinaryOptions::parse(int argc, const char *const argv[],
       op->setEnable(true);
     } else if (auto *op = findOffSwitch(argv[i])) {
       op->setEnable(false);
+    } else if (auto *op = findValueOption(argv[i])) {
+      op->setValue(argv[i] + strlen(op->name()) + 2);
     } else {
       fprintf(stderr, "%s:  unrecognized option: \"%s\"\n", progname, argv[i]);
       usage(progname, argUsage);
@@ -4,6 +4,7 @@
 #define UTILS_BINARYOPTIONS_HPP
 
 #include "binaryoption.hpp"
+#include "valueoption.hpp"
 
 #include <functional>
 #include <vector>
@@ -32,6 +33,12 @@ namespace utils {
 //   addOption(&option2);
 // }
 //
+// Options taking a value (entered as -name=value) may be added as well:
+//
+//   ValueOption option3{"", "option3", "n", "value option",
+//                       "option3 is empty unless -option3=<n> is specified"};
+//   addOption(&option3);
+//
 // // When parsing, argUsage(), argDetails() and helpExample() are invoked
 // // when "-help" is used on the command line.  Something like:
 //
@@ -83,17 +90,21 @@ public:
                                   const std::function<void()> &helpExample);
   const std::vector<BinaryOption *> &getTable() const { return table; }
   void addOption(BinaryOption *option) { table.push_back(option); }
+  void addOption(ValueOption *option) { valueTable.push_back(option); }
   void usage(const char *progname, const std::function<void()> &argUsage) const;
 
 private:
   BinaryOption *findOption(const char *arg);
   BinaryOption *findOnSwitch(const char *arg);
   BinaryOption *findOffSwitch(const char *arg);
+  ValueOption *findValueOption(const char *arg);
   static void helpOptionSummary(const BinaryOption *option);
-  void helpOptionDetails(const BinaryOption *option) const;
+  static void helpOptionSummary(const ValueOption *option);
+  void helpOptionDetails(const char *details) const;
   void helpOptions() const;
   void helpTopic(const char *progname, const char *target) const;
   std::vector<BinaryOption *> table;
+  std::vector<ValueOption *> valueTable;
   const int nWrap = 65;
 };
 
@@ -0,0 +1,215 @@
+// Copyright (C) 2022 Greg Dionne
+// Distributed under MIT License
+#include "compressedfile.hpp"
+#include "ranscodec.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace utils {
+
+// layout of the header:
+//   magic          (8 bytes)
+//   nBytes         (8 bytes, little endian)
+//   blockSize      (8 bytes, little endian)
+// followed by the compressed size of each block (8 bytes each)
+static const char magic[8] = {'J', 'A', 'N', 'U', 'S', 'R', 'Z', '1'};
+static const std::size_t headerSize = 24;
+
+static void put64(uint8_t *p, uint64_t x) {
+  for (int i = 0; i < 8; ++i) {
+    p[i] = static_cast<uint8_t>(x >> (8 * i));
+  }
+}
+
+static uint64_t get64(const uint8_t *p) {
+  uint64_t x = 0;
+  for (int i = 7; i >= 0; --i) {
+    x = x << 8 | p[i];
+  }
+  return x;
+}
+
+// number of blocks to keep in flight
+static std::size_t pipelineDepth() {
+  return 2 * std::max(1U, std::thread::hardware_concurrency());
+}
+
+// open the file positioned at the offset.  the offset must lie
+// within reach of fseek.
+static std::FILE *openAt(const std::string &path, const char *mode,
+                         std::size_t offset) {
+  std::FILE *fp = std::fopen(path.c_str(), mode);
+  if (fp && std::fseek(fp, static_cast<long>(offset), SEEK_SET)) {
+    std::fclose(fp);
+    fp = NULL;
+  }
+  return fp;
+}
+
+CompressedFile::CompressedFile(std::string filename, std::size_t offset)
+    : path(std::move(filename)), start(offset) {}
+
+bool CompressedFile::isCompressed() const {
+  std::FILE *fp = openAt(path, "rb", start);
+  if (fp == NULL) {
+    return false;
+  }
+
+  char header[sizeof(magic)];
+  bool matches = std::fread(header, 1, sizeof(header), fp) == sizeof(header) &&
+                 std::memcmp(header, magic, sizeof(magic)) == 0;
+  std::fclose(fp);
+  return matches;
+}
+
+std::size_t
+CompressedFile::read(uint8_t *data, std::size_t nBytes,
+                     const std::function<void(std::size_t)> &progress) const {
+  nCompressed = 0;
+
+  std::FILE *fp = openAt(path, "rb", start);
+  if (fp == NULL) {
+    return 0;
+  }
+
+  const std::size_t nBlocks = (nBytes + blockSize - 1) / blockSize;
+
+  // the table must match in size and layout
+  uint8_t header[headerSize];
+  std::vector<uint8_t> index(8 * nBlocks);
+  if (std::fread(header, 1, headerSize, fp) != headerSize ||
+      std::memcmp(header, magic, sizeof(magic)) != 0 ||
+      get64(header + 8) != nBytes || get64(header + 16) != blockSize ||
+      std::fread(index.data(), 1, index.size(), fp) != index.size()) {
+    std::fclose(fp);
+    return 0;
+  }
+  nCompressed = headerSize + index.size();
+
+  // read blocks in order, decoding them in parallel
+  std::deque<std::future<bool>> pending;
+  std::size_t nDone = 0;
+  bool ok = true;
+
+  auto retire = [&]() {
+    ok = pending.front().get() && ok;
+    pending.pop_front();
+    if (ok) {
+      nDone = std::min(nDone + blockSize, nBytes);
+      progress(nDone);
+    }
+  };
+
+  for (std::size_t block = 0; block < nBlocks && ok; ++block) {
+    uint8_t *out = data + block * blockSize;
+    std::size_t length = std::min(blockSize, nBytes - block * blockSize);
+
+    // blocks never grow by more than their method byte
+    auto size = static_cast<std::size_t>(get64(&index[8 * block]));
+    if (size > 1 + length) {
+      ok = false;
+      break;
+    }
+
+    auto compressed = std::make_shared<std::vector<uint8_t>>(size);
+    if (std::fread(compressed->data(), 1, size, fp) != size) {
+      ok = false;
+      break;
+    }
+    nCompressed += size;
+
+    pending.push_back(std::async(std::launch::async, [=]() {
+      return RansCodec::decode(compressed->data(), compressed->size(), out,
+                               length);
+    }));
+
+    if (pending.size() >= pipelineDepth()) {
+      retire();
+    }
+  }
+
+  while (!pending.empty()) {
+    retire();
+  }
+
+  std::fclose(fp);
+  return nDone;
+}
+
+std::size_t
+CompressedFile::write(const uint8_t *data, std::size_t nBytes,
+                      const std::function<void(std::size_t)> &progress) const {
+  nCompressed = 0;
+
+  // keep whatever precedes the offset
+  std::FILE *fp = openAt(path, start ? "r+b" : "wb", start);
+  if (fp == NULL) {
+    return 0;
+  }
+
+  const std::size_t nBlocks = (nBytes + blockSize - 1) / blockSize;
+
+  // the index is filled in once all the blocks are written
+  uint8_t header[headerSize];
+  std::memcpy(header, magic, sizeof(magic));
+  put64(header + 8, nBytes);
+  put64(header + 16, blockSize);
+  std::vector<uint8_t> index(8 * nBlocks);
+
+  bool ok = std::fwrite(header, 1, headerSize, fp) == headerSize &&
+            std::fwrite(index.data(), 1, index.size(), fp) == index.size();
+  nCompressed = headerSize + index.size();
+
+  // encode blocks in parallel, writing them in order
+  std::deque<std::future<std::vector<uint8_t>>> pending;
+  std::size_t nDone = 0;
+  std::size_t nWritten = 0;
+
+  auto retire = [&]() {
+    auto compressed = pending.front().get();
+    pending.pop_front();
+    ok = ok && std::fwrite(compressed.data(), 1, compressed.size(), fp) ==
+                   compressed.size();
+    if (ok) {
+      put64(&index[8 * nWritten++], compressed.size());
+      nCompressed += compressed.size();
+      nDone = std::min(nDone + blockSize, nBytes);
+      progress(nDone);
+    }
+  };
+
+  for (std::size_t block = 0; block < nBlocks && ok; ++block) {
+    const uint8_t *in = data + block * blockSize;
+    std::size_t length = std::min(blockSize, nBytes - block * blockSize);
+    pending.push_back(std::async(std::launch::async, [=]() {
+      return RansCodec::encode(in, length);
+    }));
+
+    if (pending.size() >= pipelineDepth()) {
+      retire();
+    }
+  }
+
+  while (!pending.empty()) {
+    retire();
+  }
+
+  // index lies well within reach of fseek
+  ok = ok &&
+       std::fseek(fp, static_cast<long>(start + headerSize), SEEK_SET) == 0 &&
+       std::fwrite(index.data(), 1, index.size(), fp) == index.size();
+
+  ok = std::fclose(fp) == 0 && ok;
+
+  return ok ? nDone : 0;
+}
+
+} // namespace utils
@@ -0,0 +1,65 @@
+// Copyright (C) 2022 Greg Dionne
+// Distributed under MIT License
+#ifndef UTILS_COMPRESSEDFILE_HPP
+#define UTILS_COMPRESSEDFILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace utils {
+
+// A large file stored as independently compressed blocks.
+//
+// The compressed data consists of a short header, an index of the
+// compressed size of each block, and the blocks themselves (see
+// RansCodec).  It may follow other (uncompressed) data at a small
+// offset into the file.
+// Blocks are read (or written) in order by the calling thread while
+// a pool of threads decodes (or encodes) them, so decompression
+// proceeds in parallel directly into the caller's buffer.
+//
+// Something like:
+//
+//   utils::CompressedFile file("table.janus");
+//   if (file.isCompressed()) {
+//     file.read(buffer, nBytes, progress);
+//   }
+class CompressedFile {
+public:
+  explicit CompressedFile(std::string filename, std::size_t offset = 0);
+
+  // true if the file exists and holds compressed data at the offset
+  bool isCompressed() const;
+
+  // reads and decompresses nBytes into data, periodically invoking
+  // progress with the number of bytes decompressed so far.  Returns
+  // the number of bytes decompressed before the first failure.
+  std::size_t read(uint8_t *data, std::size_t nBytes,
+                   const std::function<void(std::size_t)> &progress) const;
+
+  // compresses and writes nBytes from data, periodically invoking
+  // progress with the number of bytes compressed so far.  Anything
+  // preceding the offset is kept.  Returns the number of bytes
+  // compressed and written.
+  std::size_t write(const uint8_t *data, std::size_t nBytes,
+                    const std::function<void(std::size_t)> &progress) const;
+
+  // compressed bytes transferred by the last read or write
+  std::size_t compressedSize() const { return nCompressed; }
+
+  const std::string &getPath() const { return path; }
+
+  // number of uncompressed bytes in each block
+  constexpr static std::size_t blockSize = static_cast<std::size_t>(1) << 20;
+
+private:
+  const std::string path;
+  const std::size_t start;
+  mutable std::size_t nCompressed = 0;
+};
+
+} // namespace utils
+
+#endif
@@ -0,0 +1,217 @@
+// Copyright (C) 2022 Greg Dionne
+// Distributed under MIT License
+#include "ranscodec.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace utils {
+
+// layout of a coded block:
+//   method         (1 byte)
+//   frequencies    (nSymbols x 2 bytes, little endian)
+//   coder states   (2 x 4 bytes, little endian)
+//   coded stream
+static const std::size_t headerSize = 1 + 256 * 2 + 2 * 4;
+
+static void put32(uint8_t *p, uint32_t x) {
+  p[0] = static_cast<uint8_t>(x);
+  p[1] = static_cast<uint8_t>(x >> 8);
+  p[2] = static_cast<uint8_t>(x >> 16);
+  p[3] = static_cast<uint8_t>(x >> 24);
+}
+
+static uint32_t get32(const uint8_t *p) {
+  return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+         static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+}
+
+void RansCodec::normalize(const std::vector<std::size_t> &counts,
+                          std::vector<uint32_t> &freqs) {
+  std::size_t total = 0;
+  for (auto count : counts) {
+    total += count;
+  }
+
+  uint32_t sum = 0;
+  for (std::size_t s = 0; s < nSymbols; ++s) {
+    freqs[s] = counts[s] ? std::max<uint32_t>(
+                               1, static_cast<uint32_t>(counts[s] * scale /
+                                                        total))
+                         : 0;
+    sum += freqs[s];
+  }
+
+  // settle the rounding error on the most frequent symbol
+  auto largest = static_cast<std::size_t>(
+      std::max_element(freqs.begin(), freqs.end()) - freqs.begin());
+  if (freqs[largest] + scale > sum) {
+    freqs[largest] = freqs[largest] + scale - sum;
+    return;
+  }
+
+  // too many rare symbols were rounded up; take from the rest
+  while (sum > scale) {
+    for (std::size_t s = 0; s < nSymbols && sum > scale; ++s) {
+      if (freqs[s] > 1) {
+        --freqs[s];
+        --sum;
+      }
+    }
+  }
+}
+
+std::vector<uint8_t> RansCodec::encode(const uint8_t *data, std::size_t n) {
+  std::vector<std::size_t> counts(nSymbols);
+  for (std::size_t i = 0; i < n; ++i) {
+    ++counts[data[i]];
+  }
+
+  std::vector<uint32_t> freqs(nSymbols);
+  std::vector<uint32_t> starts(nSymbols);
+  if (n) {
+    normalize(counts, freqs);
+    for (std::size_t s = 1; s < nSymbols; ++s) {
+      starts[s] = starts[s - 1] + freqs[s - 1];
+    }
+  }
+
+  // the stream is written backwards from the end of the buffer.
+  // give up once it would be no smaller than the data itself.
+  std::vector<uint8_t> buffer(n);
+  uint8_t *const begin = buffer.data();
+  uint8_t *ptr = buffer.data() + buffer.size();
+
+  uint32_t states[2] = {lowerBound, lowerBound};
+  bool fits = n != 0;
+
+  // symbols are encoded in reverse so they decode in order
+  for (std::size_t i = n; i-- > 0 && fits;) {
+    uint32_t &x = states[i & 1];
+    uint32_t freq = freqs[data[i]];
+
+    uint32_t xMax = ((lowerBound >> scaleBits) << 8) * freq;
+    while (x >= xMax) {
+      if (ptr == begin) {
+        fits = false;
+        break;
+      }
+      *--ptr = static_cast<uint8_t>(x);
+      x >>= 8;
+    }
+
+    x = ((x / freq) << scaleBits) + (x % freq) + starts[data[i]];
+  }
+
+  std::size_t streamSize =
+      static_cast<std::size_t>(buffer.data() + buffer.size() - ptr);
+
+  std::vector<uint8_t> block;
+
+  if (!fits || headerSize + streamSize >= 1 + n) {
+    block.resize(1 + n);
+    block[0] = stored;
+    if (n) {
+      std::memcpy(block.data() + 1, data, n);
+    }
+    return block;
+  }
+
+  block.resize(headerSize + streamSize);
+  block[0] = coded;
+  for (std::size_t s = 0; s < nSymbols; ++s) {
+    block[1 + 2 * s] = static_cast<uint8_t>(freqs[s]);
+    block[2 + 2 * s] = static_cast<uint8_t>(freqs[s] >> 8);
+  }
+  put32(&block[headerSize - 8], states[0]);
+  put32(&block[headerSize - 4], states[1]);
+  std::memcpy(block.data() + headerSize, ptr, streamSize);
+
+  return block;
+}
+
+bool RansCodec::decode(const uint8_t *block, std::size_t blockSize,
+                       uint8_t *data, std::size_t n) {
+  if (blockSize == 0) {
+    return false;
+  }
+
+  if (block[0] == stored) {
+    if (blockSize != 1 + n) {
+      return false;
+    }
+    if (n) {
+      std::memcpy(data, block + 1, n);
+    }
+    return true;
+  }
+
+  if (block[0] != coded || blockSize < headerSize) {
+    return false;
+  }
+
+  uint32_t freqs[nSymbols];
+  uint32_t starts[nSymbols];
+  uint32_t sum = 0;
+  for (std::size_t s = 0; s < nSymbols; ++s) {
+    freqs[s] = block[1 + 2 * s] | static_cast<uint32_t>(block[2 + 2 * s]) << 8;
+    starts[s] = sum;
+    sum += freqs[s];
+  }
+  if (sum != scale) {
+    return false;
+  }
+
+  // symbol occupying each slot of the probability range along with
+  // what's needed to advance the state past it
+  struct Slot {
+    uint16_t freq;
+    uint16_t bias;
+    uint8_t symbol;
+  };
+  Slot slots[scale];
+  for (std::size_t s = 0; s < nSymbols; ++s) {
+    for (uint32_t slot = starts[s]; slot < starts[s] + freqs[s]; ++slot) {
+      slots[slot].freq = static_cast<uint16_t>(freqs[s]);
+      slots[slot].bias = static_cast<uint16_t>(slot - starts[s]);
+      slots[slot].symbol = static_cast<uint8_t>(s);
+    }
+  }
+
+  uint32_t x0 = get32(block + headerSize - 8);
+  uint32_t x1 = get32(block + headerSize - 4);
+
+  const uint8_t *ptr = block + headerSize;
+  const uint8_t *const end = block + blockSize;
+
+  // decode one symbol with state x, returning false if the stream
+  // runs out.
+  auto decodeSymbol = [&](uint32_t &x, uint8_t &out) {
+    const Slot &slot = slots[x & (scale - 1)];
+    out = slot.symbol;
+    x = slot.freq * (x >> scaleBits) + slot.bias;
+    while (x < lowerBound) {
+      if (ptr == end) {
+        return false;
+      }
+      x = x << 8 | *ptr++;
+    }
+    return true;
+  };
+
+  // even symbols use the first state and odd symbols the second
+  std::size_t i = 0;
+  for (; i + 1 < n; i += 2) {
+    if (!decodeSymbol(x0, data[i]) || !decodeSymbol(x1, data[i + 1])) {
+      return false;
+    }
+  }
+  if (i < n && !decodeSymbol(x0, data[i])) {
+    return false;
+  }
+
+  // a consistent stream is fully consumed and returns to the initial states
+  return ptr == end && x0 == lowerBound && x1 == lowerBound;
+}
+
+} // namespace utils
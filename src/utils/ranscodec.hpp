@@ -0,0 +1,61 @@
+// Copyright (C) 2022 Greg Dionne
+// Distributed under MIT License
+#ifndef UTILS_RANSCODEC_HPP
+#define UTILS_RANSCODEC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace utils {
+
+// Self-contained entropy coder for blocks of bytes.
+//
+// Each block is compressed independently with a range variant of
+// asymmetric numeral systems (rANS) using the block's own byte
+// frequencies (order-0), so blocks may be decoded in any order and
+// in parallel.  Two interleaved coder states are used to keep the
+// decoder's dependency chains short.
+//
+// A block that doesn't compress is stored as is.
+//
+// Something like:
+//
+//   auto block = utils::RansCodec::encode(data, n);
+//   ...
+//   if (!utils::RansCodec::decode(block.data(), block.size(), data, n)) {
+//     // corrupt
+//   }
+class RansCodec {
+public:
+  // compress n bytes of data into a self-contained block
+  static std::vector<uint8_t> encode(const uint8_t *data, std::size_t n);
+
+  // decompress a block produced by encode() into exactly n bytes.
+  // returns false if the block is malformed.
+  static bool decode(const uint8_t *block, std::size_t blockSize,
+                     uint8_t *data, std::size_t n);
+
+private:
+  // probabilities are expressed in units of 1/(1 << scaleBits)
+  constexpr static uint32_t scaleBits = 12;
+  constexpr static uint32_t scale = 1U << scaleBits;
+
+  // coder states are kept within [lowerBound, lowerBound << 8)
+  constexpr static uint32_t lowerBound = 1U << 23;
+
+  constexpr static std::size_t nSymbols = 256;
+
+  // block methods
+  constexpr static uint8_t stored = 0;
+  constexpr static uint8_t coded = 1;
+
+  // scale the symbol counts of a block so they sum to 'scale'
+  // while keeping every symbol that occurs representable.
+  static void normalize(const std::vector<std::size_t> &counts,
+                        std::vector<uint32_t> &freqs);
+};
+
+} // namespace utils
+
+#endif
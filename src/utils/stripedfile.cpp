@@ -0,0 +1,349 @@
+// Copyright (C) 2022 Greg Dionne
+// Distributed under MIT License
+#include "stripedfile.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#if !defined(_MSC_VER) && !defined(__MINGW32__) && !defined(__MINGW64__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define UTILS_HAS_PREAD
+#endif
+
+namespace utils {
+
+StripedFile::StripedFile(std::vector<std::string> stripePaths, bool direct)
+    : paths(std::move(stripePaths)), useDirect(direct) {}
+
+std::size_t
+StripedFile::read(uint8_t *data, std::size_t nBytes, std::size_t offset,
+                  const std::function<void(std::size_t)> &progress) const {
+  return transfer(data, nBytes, offset, false, progress);
+}
+
+std::size_t
+StripedFile::write(const uint8_t *data, std::size_t nBytes, std::size_t offset,
+                   const std::function<void(std::size_t)> &progress) const {
+  // data is only read from when writing
+  return transfer(const_cast<uint8_t *>(data), nBytes, offset, true,
+                  progress);
+}
+
+bool StripedFile::remove() const {
+  bool removed = true;
+  for (std::size_t stripe = 0; stripe < paths.size(); ++stripe) {
+    if (std::remove(paths[stripe].c_str())) {
+      fail(stripe, errno);
+      removed = false;
+    }
+  }
+  return removed;
+}
+
+void StripedFile::fail(std::size_t stripe, int error) const {
+  failed = paths[stripe];
+  failedErrno = error;
+  errno = error;
+}
+
+#ifdef UTILS_HAS_PREAD
+
+// O_DIRECT transfers must be aligned to the device's block size
+static const std::size_t directAlignment = 4096;
+
+// size of the specified stripe when the whole file ends at 'end'
+static std::size_t stripeSize(std::size_t stripe, std::size_t nStripes,
+                              std::size_t end) {
+  const std::size_t chunkSize = StripedFile::chunkSize;
+  std::size_t size = 0;
+  for (std::size_t chunk = stripe; chunk * chunkSize < end;
+       chunk += nStripes) {
+    size += std::min(chunkSize, end - chunk * chunkSize);
+  }
+  return size;
+}
+
+std::size_t StripedFile::size() const {
+  std::size_t total = 0;
+  for (std::size_t stripe = 0; stripe < paths.size(); ++stripe) {
+    struct stat st;
+    if (stat(paths[stripe].c_str(), &st) == -1) {
+      fail(stripe, errno);
+      return 0;
+    }
+    total += static_cast<std::size_t>(st.st_size);
+  }
+  return total;
+}
+
+// read (or write) the entire buffer at the specified offset.
+// returns the number of bytes transferred before EOF or an error.
+static std::size_t transferAll(int fd, uint8_t *buffer, std::size_t length,
+                               std::size_t offset, bool writing) {
+  std::size_t done = 0;
+  while (done < length) {
+    ssize_t n = writing ? pwrite(fd, buffer + done, length - done,
+                                 static_cast<off_t>(offset + done))
+                        : pread(fd, buffer + done, length - done,
+                                static_cast<off_t>(offset + done));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      break;
+    }
+    done += static_cast<std::size_t>(n);
+  }
+  return done;
+}
+
+std::size_t
+StripedFile::transfer(uint8_t *data, std::size_t nBytes, std::size_t offset,
+                      bool writing,
+                      const std::function<void(std::size_t)> &progress) const {
+
+  const std::size_t nStripes = paths.size();
+  const std::size_t end = offset + nBytes;
+
+  // only a write at the start replaces the file
+  int flags = writing ? O_WRONLY | O_CREAT : O_RDONLY;
+  if (writing && offset == 0) {
+    flags |= O_TRUNC;
+  }
+#ifdef O_DIRECT
+  if (useDirect) {
+    flags |= O_DIRECT;
+  }
+#endif
+
+  std::vector<int> fds(nStripes, -1);
+  for (std::size_t stripe = 0; stripe < nStripes; ++stripe) {
+    fds[stripe] = open(paths[stripe].c_str(), flags, 0644);
+    if (fds[stripe] == -1) {
+      int error = errno;
+      for (int fd : fds) {
+        if (fd != -1) {
+          close(fd);
+        }
+      }
+      fail(stripe, error);
+      return 0;
+    }
+#if !defined(O_DIRECT) && defined(F_NOCACHE)
+    if (useDirect) {
+      fcntl(fds[stripe], F_NOCACHE, 1);
+    }
+#endif
+  }
+
+  const std::size_t firstChunk = offset / chunkSize;
+  const std::size_t nChunks =
+      nBytes ? (end + chunkSize - 1) / chunkSize - firstChunk : 0;
+
+  std::atomic<std::size_t> nextChunk{0};
+  std::atomic<std::size_t> nDone{0};
+  std::atomic<bool> failure{false};
+
+  // first failure
+  std::mutex failureMutex;
+  std::size_t failedStripe = 0;
+  int failedError = 0;
+
+  auto worker = [&]() {
+    // bounce buffer for unaligned direct transfers
+    std::unique_ptr<void, decltype(&std::free)> bounce(nullptr, &std::free);
+
+    for (std::size_t i = nextChunk++; i < nChunks && !failure;
+         i = nextChunk++) {
+      // portion of the chunk within the transfer
+      std::size_t chunk = firstChunk + i;
+      std::size_t begin = std::max(offset, chunk * chunkSize);
+      std::size_t length = std::min(end, (chunk + 1) * chunkSize) - begin;
+      std::size_t stripe = chunk % nStripes;
+      std::size_t position =
+          chunk / nStripes * chunkSize + begin - chunk * chunkSize;
+
+      uint8_t *buffer = data + begin - offset;
+      std::size_t ioLength = length;
+
+      bool aligned = reinterpret_cast<uintptr_t>(buffer) % directAlignment ==
+                         0 &&
+                     length % directAlignment == 0;
+
+      if (useDirect && !aligned) {
+        if (!bounce) {
+          void *p = nullptr;
+          if (posix_memalign(&p, directAlignment, chunkSize) == 0) {
+            bounce.reset(p);
+          }
+        }
+        if (bounce) {
+          buffer = static_cast<uint8_t *>(bounce.get());
+          ioLength = (length + directAlignment - 1) / directAlignment *
+                     directAlignment;
+          if (writing) {
+            std::memcpy(buffer, data + begin - offset, length);
+            std::memset(buffer + length, 0, ioLength - length);
+          }
+        }
+      }
+
+      errno = 0;
+      std::size_t n =
+          transferAll(fds[stripe], buffer, ioLength, position, writing);
+
+      if (n < length) {
+        std::lock_guard<std::mutex> lock(failureMutex);
+        if (!failure) {
+          failedStripe = stripe;
+          failedError = errno ? errno : EIO;
+          failure = true;
+        }
+        break;
+      }
+
+      if (!writing && buffer != data + begin - offset) {
+        std::memcpy(data + begin - offset, buffer, length);
+      }
+
+      nDone += length;
+    }
+  };
+
+  std::size_t nThreads = std::max(1U, std::thread::hardware_concurrency());
+  nThreads = std::max<std::size_t>(std::min(nThreads, nChunks), 1);
+
+  std::vector<std::future<void>> workers(nThreads);
+  for (auto &w : workers) {
+    w = std::async(std::launch::async, worker);
+  }
+
+  // report progress while waiting
+  for (auto &w : workers) {
+    while (w.wait_for(std::chrono::milliseconds(250)) !=
+           std::future_status::ready) {
+      progress(nDone);
+    }
+    w.get();
+  }
+  progress(nDone);
+
+  // direct writes are padded to the block size; trim each stripe
+  for (std::size_t stripe = 0; stripe < nStripes; ++stripe) {
+    if (writing && useDirect && !failure) {
+      auto size = static_cast<off_t>(stripeSize(stripe, nStripes, end));
+      if (ftruncate(fds[stripe], size) == -1 && !failure) {
+        failedStripe = stripe;
+        failedError = errno;
+        failure = true;
+      }
+    }
+    close(fds[stripe]);
+  }
+
+  if (failure) {
+    fail(failedStripe, failedError);
+  }
+
+  // a failed trim still counts as a short transfer
+  return failure ? std::min<std::size_t>(nDone, nBytes - 1) : nBytes;
+}
+
+#else
+
+std::size_t StripedFile::size() const {
+  std::size_t total = 0;
+  for (std::size_t stripe = 0; stripe < paths.size(); ++stripe) {
+    std::FILE *fp = std::fopen(paths[stripe].c_str(), "rb");
+    if (fp == NULL) {
+      fail(stripe, errno);
+      return 0;
+    }
+    // 64-bit offsets; long is only 32 bits on Windows
+    long long length = -1;
+    if (_fseeki64(fp, 0, SEEK_END) == 0) {
+      length = _ftelli64(fp);
+    }
+    if (length < 0) {
+      fail(stripe, errno);
+      std::fclose(fp);
+      return 0;
+    }
+    std::fclose(fp);
+    total += static_cast<std::size_t>(length);
+  }
+  return total;
+}
+
+// transfer chunks sequentially
+std::size_t
+StripedFile::transfer(uint8_t *data, std::size_t nBytes, std::size_t offset,
+                      bool writing,
+                      const std::function<void(std::size_t)> &progress) const {
+
+  const std::size_t nStripes = paths.size();
+  const std::size_t end = offset + nBytes;
+
+  // only a write at the start replaces the file
+  const char *mode = !writing ? "rb" : offset == 0 ? "wb" : "r+b";
+
+  std::vector<std::FILE *> fps(nStripes);
+  for (std::size_t stripe = 0; stripe < nStripes; ++stripe) {
+    fps[stripe] = std::fopen(paths[stripe].c_str(), mode);
+    if (fps[stripe] == NULL) {
+      int error = errno;
+      for (auto fp : fps) {
+        if (fp) {
+          std::fclose(fp);
+        }
+      }
+      fail(stripe, error);
+      return 0;
+    }
+  }
+
+  std::size_t nDone = 0;
+  for (std::size_t chunk = offset / chunkSize; chunk * chunkSize < end;
+       ++chunk) {
+    std::size_t begin = std::max(offset, chunk * chunkSize);
+    std::size_t length = std::min(end, (chunk + 1) * chunkSize) - begin;
+    std::size_t stripe = chunk % nStripes;
+    std::size_t position =
+        chunk / nStripes * chunkSize + begin - chunk * chunkSize;
+
+    std::FILE *fp = fps[stripe];
+    std::size_t n = 0;
+    if (_fseeki64(fp, static_cast<long long>(position), SEEK_SET) == 0) {
+      n = writing ? std::fwrite(data + begin - offset, 1, length, fp)
+                  : std::fread(data + begin - offset, 1, length, fp);
+    }
+    nDone += n;
+    progress(nDone);
+    if (n != length) {
+      fail(stripe, errno ? errno : EIO);
+      break;
+    }
+  }
+
+  for (auto fp : fps) {
+    std::fclose(fp);
+  }
+
+  return nDone;
+}
+
+#endif
+
+} // namespace utils
@@ -0,0 +1,86 @@
+// Copyright (C) 2022 Greg Dionne
+// Distributed under MIT License
+#ifndef UTILS_STRIPEDFILE_HPP
+#define UTILS_STRIPEDFILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace utils {
+
+// A large file that is read and written in fixed-size chunks by
+// several threads at once.
+//
+// The file may be striped across more than one path (typically on
+// different disks), in which case chunk k is kept in path k % nPaths.
+// Offsets passed to read() and write() are offsets into the whole
+// (unstriped) file; chunk k covers offsets [k, k + 1) * chunkSize.
+//
+// Something like:
+//
+//   utils::StripedFile file({"/disk0/table", "/disk1/table"});
+//   auto progress = [](std::size_t nDone) { printf("%zu\n", nDone); };
+//   if (file.read(buffer, nBytes, 0, progress) != nBytes) {
+//     perror(file.failedPath().c_str());
+//   }
+//
+// On POSIX systems, chunks are transferred in parallel with pread and
+// pwrite.  When 'direct' is specified, the operating system's file
+// cache is bypassed (O_DIRECT); offsets should then be multiples of
+// 4096.  Elsewhere chunks are transferred sequentially.
+class StripedFile {
+public:
+  explicit StripedFile(std::vector<std::string> stripePaths,
+                       bool direct = false);
+
+  // reads nBytes at the specified offset into data, periodically
+  // invoking progress with the number of bytes transferred so far.
+  // Returns the number of bytes read.
+  std::size_t read(uint8_t *data, std::size_t nBytes, std::size_t offset,
+                   const std::function<void(std::size_t)> &progress) const;
+
+  // writes nBytes from data at the specified offset, periodically
+  // invoking progress with the number of bytes transferred so far.
+  // Writing at offset zero replaces any existing file.  Returns the
+  // number of bytes written.
+  std::size_t write(const uint8_t *data, std::size_t nBytes,
+                    std::size_t offset,
+                    const std::function<void(std::size_t)> &progress) const;
+
+  // total size of all stripes.  returns zero if any stripe is missing.
+  std::size_t size() const;
+
+  // removes all stripes.  returns false if any could not be removed.
+  bool remove() const;
+
+  // path of the stripe that last failed (errno holds the reason)
+  const std::string &failedPath() const { return failed; }
+
+  // paths of each stripe
+  const std::vector<std::string> &getPaths() const { return paths; }
+
+  // number of bytes in each chunk
+  constexpr static std::size_t chunkSize = static_cast<std::size_t>(64) << 20;
+
+private:
+  // read or write all chunks
+  std::size_t transfer(uint8_t *data, std::size_t nBytes, std::size_t offset,
+                       bool writing,
+                       const std::function<void(std::size_t)> &progress) const;
+
+  // record a failure
+  void fail(std::size_t stripe, int error) const;
+
+  const std::vector<std::string> paths;
+  const bool useDirect;
+
+  mutable std::string failed;
+  mutable int failedErrno = 0;
+};
+
+} // namespace utils
+
+#endif
@@ -0,0 +1,31 @@
+// Copyright (C) 2022 Greg Dionne
+// Distributed under MIT License
+#ifndef UTILS_VALUEOPTION_HPP
+#define UTILS_VALUEOPTION_HPP
+
+// option that takes a value on the command line.  e.g.,
+//   -name=value
+class ValueOption {
+public:
+  ValueOption(const char *v, const char *name, const char *meta,
+              const char *summary, const char *details)
+      : value(v), nameValue(name), metaValue(meta), helpSummary(summary),
+        helpDetails(details) {}
+
+  const char *c_str() const { return value; }
+  const char *name() const { return nameValue; }
+  const char *meta() const { return metaValue; }
+  const char *summary() const { return helpSummary; }
+  const char *details() const { return helpDetails; }
+  bool isSet() const { return value && value[0]; }
+  void setValue(const char *v) { value = v; }
+
+private:
+  const char *value;
+  const char *const nameValue;
+  const char *const metaValue;
+  const char *const helpSummary;
+  const char *const helpDetails;
+};
+
+#endif
@@ -17,12 +17,18 @@
 #include <ws2tcpip.h>
 
 #include <functional>
+#include <mutex>
 
 // Need to link with Ws2_32.lib
 #pragma comment(lib, "Ws2_32.lib")
 // #pragma comment (lib, "Mswsock.lib")
 
+// active client.  it is only changed by the accepting thread, but
+// other threads may send to it, so changes and sends are made under
+// the mutex.  errors only shut the socket down, so it stays open
+// until closeSocket().
 static SOCKET ClientSocket = INVALID_SOCKET;
+static std::mutex ClientMutex;
 
 int createServer(const char *port, std::function<void()> callback) {
   WSADATA wsaData;
@@ -88,14 +94,19 @@ int createServer(const char *port, std::function<void()> callback) {
     printf("Waiting for connection...\n");
 
     // Accept a client socket
-    ClientSocket = accept(ListenSocket, NULL, NULL);
-    if (ClientSocket == INVALID_SOCKET) {
+    SOCKET NewSocket = accept(ListenSocket, NULL, NULL);
+    if (NewSocket == INVALID_SOCKET) {
       printf("accept failed with error: %d\n", WSAGetLastError());
       closesocket(ListenSocket);
       WSACleanup();
       return 1;
     }
 
+    {
+      std::lock_guard<std::mutex> lock(ClientMutex);
+      ClientSocket = NewSocket;
+    }
+
     printf("invoking callback...\n");
     callback();
   }
@@ -114,21 +125,30 @@ int readSocket(char *recvbuf, int recvbuflen) {
 }
 
 int writeSocket(const char *sendbuf, int sendbuflen) {
+  std::lock_guard<std::mutex> lock(ClientMutex);
+
+  // nobody to tell (e.g. while loading before the first connection)
+  if (ClientSocket == INVALID_SOCKET) {
+    return 0;
+  }
+
   int iSendResult = send(ClientSocket, sendbuf, sendbuflen, 0);
   if (iSendResult == SOCKET_ERROR) {
     printf("send failed with error: %d\n", WSAGetLastError());
-    closesocket(ClientSocket);
+    shutdown(ClientSocket, SD_BOTH);
   }
   return iSendResult;
 }
 
 void closeSocket() {
+  std::lock_guard<std::mutex> lock(ClientMutex);
   int iResult = shutdown(ClientSocket, SD_SEND);
   if (iResult == SOCKET_ERROR) {
     printf("shutdown failed with error: %d\n", WSAGetLastError());
   }
   printf("Connection closing...\n");
   closesocket(ClientSocket);
+  ClientSocket = INVALID_SOCKET;
 }
 
 #endif